@@ -0,0 +1,174 @@
+# 分别构建各优化配置的命令行程序，在相同的合成语料上运行吞吐量测试，输出每种语料相对Release的加速比
+# 用法：cmake -DSOURCE_DIR=源码目录 -DBINARY_DIR=构建目录 [-DGENERATOR=生成器] [-DCXX_COMPILER=编译器]
+#             [-DCORPUS_SIZE=字节数] [-DPASSES=遍数] [-DCONFIGS=release;lto;native;pgo;lto-native-pgo] -P bench_configs.cmake
+# 结果另存为BINARY_DIR/summary.json，各配置的完整结果在BINARY_DIR/<配置>/bench.json
+cmake_minimum_required(VERSION 3.19)
+
+if(NOT SOURCE_DIR OR NOT BINARY_DIR)
+    message(FATAL_ERROR "SOURCE_DIR and BINARY_DIR are required")
+endif()
+if(NOT CORPUS_SIZE)
+    set(CORPUS_SIZE 4000000)
+endif()
+if(NOT PASSES)
+    set(PASSES 3)
+endif()
+if(NOT CONFIGS)
+    set(CONFIGS release lto native pgo lto-native-pgo)
+endif()
+
+# 各配置对应的选项，名称中用-连接的部分依次叠加
+set(release_options "")
+set(lto_options -DLEXER_LTO=ON)
+set(native_options -DLEXER_NATIVE=ON)
+
+function(run_checked)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "command failed (${result}): ${ARGN}")
+    endif()
+endfunction()
+
+function(configure_and_build dir)
+    set(generator_args)
+    if(GENERATOR)
+        list(APPEND generator_args -G ${GENERATOR})
+    endif()
+    if(CXX_COMPILER)
+        list(APPEND generator_args -DCMAKE_CXX_COMPILER=${CXX_COMPILER})
+    endif()
+    run_checked(${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${dir} ${generator_args} -DCMAKE_BUILD_TYPE=Release
+        -DLEXER_BENCH_CORPUS_SIZE=${CORPUS_SIZE} ${ARGN})
+    run_checked(${CMAKE_COMMAND} --build ${dir} --config Release --target lexical_analysis)
+endfunction()
+
+# 单配置生成器的程序在构建目录下，多配置生成器在Release子目录下
+function(find_program_in dir result)
+    foreach(candidate ${dir}/lexical_analysis ${dir}/lexical_analysis.exe ${dir}/Release/lexical_analysis ${dir}/Release/lexical_analysis.exe)
+        if(EXISTS ${candidate} AND NOT IS_DIRECTORY ${candidate})
+            set(${result} ${candidate} PARENT_SCOPE)
+            return()
+        endif()
+    endforeach()
+    message(FATAL_ERROR "lexical_analysis was not built in ${dir}")
+endfunction()
+
+# JSON中的数值转换为千分之一的整数（毫秒即转换为微秒）（舍去3位以后的小数），CMake的math只支持整数
+function(json_milli json result)
+    string(JSON value GET ${json} ${ARGN})
+    if(NOT value MATCHES "^([0-9]+)(\\.([0-9]*))?$")
+        message(FATAL_ERROR "unexpected number ${value}")
+    endif()
+    set(whole ${CMAKE_MATCH_1})
+    string(SUBSTRING "${CMAKE_MATCH_3}000" 0 3 fraction)
+    string(REGEX REPLACE "^0+([0-9])" "\\1" fraction ${fraction})
+    math(EXPR milli "${whole} * 1000 + ${fraction}")
+    set(${result} ${milli} PARENT_SCOPE)
+endfunction()
+
+# 千分之一的整数格式化为带3位小数的字符串
+function(format_milli value result)
+    math(EXPR whole "${value} / 1000")
+    math(EXPR fraction "${value} % 1000 + 1000")
+    string(SUBSTRING ${fraction} 1 3 fraction)
+    set(${result} "${whole}.${fraction}" PARENT_SCOPE)
+endfunction()
+
+# 先构建全部配置
+foreach(config ${CONFIGS})
+    set(dir ${BINARY_DIR}/${config})
+    string(REPLACE "-" ";" parts ${config})
+    set(options)
+    set(pgo FALSE)
+    foreach(part ${parts})
+        if(part STREQUAL "pgo")
+            set(pgo TRUE)
+        elseif(DEFINED ${part}_options)
+            list(APPEND options ${${part}_options})
+        else()
+            message(FATAL_ERROR "unknown configuration ${part} in ${config}")
+        endif()
+    endforeach()
+
+    message(STATUS "[${config}] building")
+    if(pgo)
+        # 先构建插桩程序并训练，再在同一目录中用训练结果重新构建
+        file(REMOVE_RECURSE ${dir}/pgo)
+        configure_and_build(${dir} ${options} -DLEXER_PGO=generate)
+        run_checked(${CMAKE_COMMAND} --build ${dir} --config Release --target pgo-train)
+        configure_and_build(${dir} ${options} -DLEXER_PGO=use)
+    else()
+        configure_and_build(${dir} ${options} -DLEXER_PGO=)
+    endif()
+    find_program_in(${dir} program_${config})
+endforeach()
+
+# 各配置轮流测试PASSES遍，每种语料取各遍中最短的耗时，减少机器负载变化对比较的影响
+foreach(pass RANGE 1 ${PASSES})
+    foreach(config ${CONFIGS})
+        message(STATUS "[${config}] benchmarking, pass ${pass}/${PASSES}")
+        set(json_path ${BINARY_DIR}/${config}/bench.json)
+        execute_process(COMMAND ${program_${config}} --bench-corpus --corpus-size=${CORPUS_SIZE} --json=${json_path}
+            RESULT_VARIABLE result OUTPUT_QUIET)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "benchmark of ${config} failed (${result})")
+        endif()
+        file(READ ${json_path} json)
+        string(JSON result_num LENGTH ${json} results)
+        math(EXPR last "${result_num} - 1")
+        set(mixes)
+        foreach(i RANGE ${last})
+            string(JSON mix GET ${json} results ${i} mix)
+            string(JSON bytes_${mix} GET ${json} results ${i} bytes)
+            list(APPEND mixes ${mix})
+            json_milli(${json} us results ${i} lexical_analysis ms)
+            if(NOT DEFINED best_${config}_${mix} OR us LESS best_${config}_${mix})
+                set(best_${config}_${mix} ${us})
+            endif()
+        endforeach()
+    endforeach()
+endforeach()
+
+# 以第一个配置（默认为release）为基准，比较lexical_analysis整体的耗时
+list(GET CONFIGS 0 base_config)
+set(base_total 0)
+foreach(mix ${mixes})
+    math(EXPR base_total "${base_total} + ${best_${base_config}_${mix}}")
+endforeach()
+set(summary "{\n  \"corpus_size\": ${CORPUS_SIZE},\n  \"passes\": ${PASSES},\n  \"baseline\": \"${base_config}\",\n  \"configs\": [")
+set(report)
+set(first_config TRUE)
+foreach(config ${CONFIGS})
+    set(line "")
+    set(entries "")
+    set(total 0)
+    foreach(mix ${mixes})
+        set(us ${best_${config}_${mix}})
+        math(EXPR total "${total} + ${us}")
+        math(EXPR speedup "${best_${base_config}_${mix}} * 1000 / ${us}")
+        math(EXPR mb_per_s "${bytes_${mix}} * 1000 / ${us}")
+        format_milli(${speedup} speedup_text)
+        format_milli(${mb_per_s} mb_text)
+        string(APPEND line ";  ${mix}: ${mb_text} MB/s, ${speedup_text}x")
+        if(NOT entries STREQUAL "")
+            string(APPEND entries ", ")
+        endif()
+        string(APPEND entries "\"${mix}\": { \"mb_per_s\": ${mb_text}, \"speedup\": ${speedup_text} }")
+    endforeach()
+    math(EXPR total_speedup "${base_total} * 1000 / ${total}")
+    format_milli(${total_speedup} total_text)
+    list(APPEND report "${config}: ${total_text}x over ${base_config} in total${line}")
+    if(NOT first_config)
+        string(APPEND summary ",")
+    endif()
+    string(APPEND summary "\n    { \"config\": \"${config}\", \"speedup\": ${total_text}, \"mixes\": { ${entries} } }")
+    set(first_config FALSE)
+endforeach()
+string(APPEND summary "\n  ]\n}\n")
+file(WRITE ${BINARY_DIR}/summary.json ${summary})
+
+message("\nlexical_analysis throughput by configuration (corpus ${CORPUS_SIZE} bytes, speedup relative to ${base_config}):")
+foreach(line ${report})
+    message("${line}")
+endforeach()
+message("results: ${BINARY_DIR}/summary.json")
@@ -0,0 +1,8 @@
+﻿#pragma once
+#include <cstddef>
+
+//程序启动以来全局operator new的调用次数，用于检查词法分析热路径上是否有堆分配
+size_t allocation_count();
+
+//进程的峰值常驻内存（字节），无法取得时返回0
+size_t peak_memory_usage();
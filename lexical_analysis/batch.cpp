@@ -0,0 +1,197 @@
+﻿#include "batch.h"
+#include "lexical_analysis.h"
+#include "source_buffer.h"
+#include "line_index.h"
+#include "lex_cache.h"
+#include "thread_pool.h"
+#include "file_prefetcher.h"
+#include "concurrent_symbol_table.h"
+#include "frequency_summary.h"
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+vector<string> collect_sources(const vector<string>& paths)
+{
+    vector<string> files;
+    for (const string& path : paths)
+    {
+        error_code ec;
+        if (!fs::is_directory(path, ec))
+        {
+            files.push_back(path);
+            continue;
+        }
+        vector<string> found;
+        for (fs::recursive_directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec))
+        {
+            if (!it->is_regular_file(ec))
+                continue;
+            string extension = it->path().extension().string();
+            if (extension == ".c" || extension == ".h")
+                found.push_back(it->path().string());
+        }
+        sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+    }
+    return files;
+}
+
+//工作线程私有的分析数据，分析下一个文件前清空，保留已分配的空间
+struct worker_state
+{
+    token_buffer token_stream;
+    symbol_table id_list;
+    symbol_table str_list;
+    ostringstream errors;
+    unique_ptr<frequency_summary> summary;  //批量分析需要频率统计时为本线程的汇总
+};
+
+//分析已载入内存的源程序
+static void analyze_source(const string& path, source_buffer& program, bool use_table, lex_cache* cache, concurrent_symbol_table* global_ids,
+    worker_state& state, file_statistics& result)
+{
+    result.opened = true;
+    state.token_stream.clear();
+    state.id_list.clear();
+    state.str_list.clear();
+    state.errors.str("");
+    line_index lines(path, program.data, program.size);
+    error_output = &state.errors;
+    error_lines = &lines;
+    if (cache)
+        cache->analyze(state.token_stream, state.id_list, state.str_list, result.line_num, result.word_type_num, result.char_num, program, use_table);
+    else if (use_table)
+        table_lexical_analysis(state.token_stream, state.id_list, state.str_list, result.line_num, result.word_type_num, result.char_num, program);
+    else
+        lexical_analysis(state.token_stream, state.id_list, state.str_list, result.line_num, result.word_type_num, result.char_num, program);
+    error_output = &cout;
+    error_lines = nullptr;
+
+    result.token_num = state.token_stream.size();
+    result.id_num = state.id_list.size();
+    result.str_num = state.str_list.size();
+    result.errors = state.errors.str();
+
+    //每个文件的标志符只插入一次，不按出现次数插入
+    if (global_ids)
+    {
+        result.global_ids.resize(state.id_list.size());
+        for (size_t i = 0; i < state.id_list.size(); i++)
+            result.global_ids[i] = global_ids->insert(state.id_list[i]);
+    }
+    if (state.summary)
+        state.summary->add(state.id_list, state.str_list, result.word_type_num);
+}
+
+static void analyze_file(const string& path, bool use_table, lex_cache* cache, concurrent_symbol_table* global_ids, worker_state& state, file_statistics& result)
+{
+    result.path = path;
+    result.word_type_num.assign(WORD_TYPE_AMOUNT, 0);
+    source_buffer program;
+    if (open_source(program, path))
+        analyze_source(path, program, use_table, cache, global_ids, state, result);
+}
+
+void batch_analysis(const vector<string>& files, int thread_num, bool use_table, vector<file_statistics>& results, lex_cache* cache, prefetch_mode prefetch,
+    concurrent_symbol_table* global_ids, frequency_summary* summary)
+{
+    results.assign(files.size(), file_statistics());
+    thread_pool pool(thread_num);
+    vector<worker_state> states(pool.size());
+    if (summary)
+    {
+        for (worker_state& state : states)
+            state.summary = make_unique<frequency_summary>(summary->get_ids().get_width(), summary->get_ids().get_depth());
+    }
+    //各线程的汇总按线程顺序合并，精确统计的结果与线程数无关
+    auto merge_summaries = [&]() {
+        if (summary)
+            for (worker_state& state : states)
+                summary->merge(*state.summary);
+    };
+    if (prefetch != PREFETCH_OFF)
+    {
+        //每个工作线程不断取出预读好的文件，缓冲区每个线程约4个，读取可以领先分析
+        file_prefetcher prefetcher(files, prefetch, 4 * pool.size() + 4);
+        for (int i = 0; i < pool.size(); i++)
+        {
+            pool.submit([&](int worker) {
+                while (file_buffer* buffer = prefetcher.next())
+                {
+                    file_statistics& result = results[buffer->index];
+                    result.path = files[buffer->index];
+                    result.word_type_num.assign(WORD_TYPE_AMOUNT, 0);
+                    if (buffer->opened)
+                    {
+                        source_buffer program;
+                        program.data = buffer->data.data();
+                        program.size = buffer->size;
+                        analyze_source(result.path, program, use_table, cache, global_ids, states[worker], result);
+                    }
+                    prefetcher.recycle(buffer);
+                }
+            });
+        }
+        pool.wait();
+        merge_summaries();
+        return;
+    }
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        pool.submit([&, i](int worker) {
+            analyze_file(files[i], use_table, cache, global_ids, states[worker], results[i]);
+        });
+    }
+    pool.wait();
+    merge_summaries();
+}
+
+void print_batch_report(ostream& out, const vector<file_statistics>& results)
+{
+    vector<int> word_type_num(WORD_TYPE_AMOUNT);
+    long long char_num = 0;
+    long long line_num = 0;
+    size_t token_num = 0;
+
+    out << "file list:" << endl;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const file_statistics& result = results[i];
+        out << setiosflags(ios::left) << setw(10) << i << result.path;
+        if (!result.opened)
+        {
+            out << " (cannot open)" << endl;
+            continue;
+        }
+        out << " (lines: " << result.line_num << ", chars: " << result.char_num << ", tokens: " << result.token_num
+            << ", ids: " << result.id_num << ", strings: " << result.str_num << ")" << endl;
+        for (int j = 0; j < WORD_TYPE_AMOUNT; j++)
+            word_type_num[j] += result.word_type_num[j];
+        char_num += result.char_num;
+        line_num += result.line_num;
+        token_num += result.token_num;
+    }
+
+    //错误信息已带有文件名、行号和列号
+    out << endl << "errors:" << endl;
+    for (const file_statistics& result : results)
+        out << result.errors;
+
+    out << endl << "word type num:" << endl;
+    for (int i = 0; i < WORD_TYPE_AMOUNT; i++)
+    {
+        out << setiosflags(ios::left) << setw(14) << to_string((word_type)i) << word_type_num[i] << endl;
+    }
+
+    out << "file num: " << results.size() << endl;
+    out << "token num: " << token_num << endl;
+    out << "char num: " << char_num << endl;
+    out << "line num: " << line_num << endl;
+}
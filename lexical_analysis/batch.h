@@ -0,0 +1,50 @@
+﻿#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "file_prefetcher.h"
+
+class lex_cache;
+class concurrent_symbol_table;
+class frequency_summary;
+
+//批量分析中单个源程序的统计结果
+struct file_statistics
+{
+    std::string path;
+    bool opened = false;                //是否成功打开
+    int line_num = 0;                   //行数
+    int char_num = 0;                   //字符总数
+    size_t token_num = 0;               //记号数
+    size_t id_num = 0;                  //不同标志符数
+    size_t str_num = 0;                 //不同字符串数
+    std::vector<int> word_type_num;     //每种单词类型的数量
+    std::string errors;                 //词法错误信息
+    std::vector<uint32_t> global_ids;   //使用全局标志符表时，文件中各标志符（按文件内的编号）在全局表中的编号
+};
+
+/**
+ * 收集需要分析的源程序
+ * 文件直接加入；目录递归加入其中的.c和.h文件，同一目录下的文件按路径排序，保证结果与遍历顺序无关
+ */
+std::vector<std::string> collect_sources(const std::vector<std::string>& paths);
+
+/**
+ * 使用工作窃取线程池并行分析多个源程序
+ * 每个工作线程拥有自己的记号流和符号表，分析不同文件时重复使用，线程之间没有共享的可写数据
+ * const std::vector<std::string>& files - 源程序路径
+ * int thread_num - 线程数，0表示使用硬件并发数
+ * bool use_table - 是否使用表驱动DFA
+ * std::vector<file_statistics>& results - 按files的顺序返回各文件的统计结果，与线程数无关
+ * lex_cache* cache - 词法分析缓存，为nullptr时不使用缓存
+ * prefetch_mode prefetch - 读取源程序的方式，不为PREFETCH_OFF时由file_prefetcher预读，读取与分析重叠进行，结果相同
+ * concurrent_symbol_table* global_ids - 全局标志符表，不为nullptr时各工作线程分析完一个文件后把其中的标志符插入该表，
+ *                                       编号记录在file_statistics::global_ids中
+ * frequency_summary* summary - 频率统计汇总，不为nullptr时各工作线程把分析结果加入自己的汇总（与summary的统计方式相同），结束后按线程合并到summary中
+ */
+void batch_analysis(const std::vector<std::string>& files, int thread_num, bool use_table, std::vector<file_statistics>& results, lex_cache* cache = nullptr,
+    prefetch_mode prefetch = PREFETCH_OFF, concurrent_symbol_table* global_ids = nullptr, frequency_summary* summary = nullptr);
+
+//按文件顺序输出各文件的统计和错误，以及所有文件合计的各类单词个数、字符总数和行数
+void print_batch_report(std::ostream& out, const std::vector<file_statistics>& results);
@@ -0,0 +1,899 @@
+﻿#include "benchmark.h"
+#include "keyword.h"
+#include "lexical_analysis.h"
+#include "output_buffer.h"
+#include "source_buffer.h"
+#include "token_file.h"
+#include "incremental_lexer.h"
+#include "lexer_session.h"
+#include "alloc_counter.h"
+#include "simd_scan.h"
+#include "batch.h"
+#include "file_prefetcher.h"
+#include "concurrent_symbol_table.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+//原先的关键字查找：二分搜索str在keyword_list的位置，若搜索到返回位置，否者返回-1
+static int binary_search_reserve(const vector<string>& keyword_list, const string& str)
+{
+    int high = keyword_list.size() - 1;
+    int low = 0;
+    int middle = (high + low) / 2;
+    while (high >= low)
+    {
+        middle = (high + low) / 2;
+        if (keyword_list[middle].compare(str) == 0)
+            return middle;
+        else if (keyword_list[middle].compare(str) < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+    return -1;
+}
+
+//测试单词表：全部关键字加上常见的标志符，标志符与关键字约各占一半
+static vector<string> benchmark_words()
+{
+    vector<string> words(begin(KEYWORD_NAMES), end(KEYWORD_NAMES));
+    const char* ids[] = { "i", "j", "n", "main", "printf", "buf", "len", "count", "index", "result",
+        "node", "next", "size_t", "value", "ptr", "data", "tmp", "argc", "argv", "token_stream",
+        "line_num", "char_num", "st", "s1", "s2", "dot", "iff", "doubles", "unsigned_", "whilst",
+        "case1", "forward" };
+    words.insert(words.end(), begin(ids), end(ids));
+    return words;
+}
+
+void keyword_benchmark(ostream& out, int rounds)
+{
+    vector<string> keyword_list(begin(KEYWORD_NAMES), end(KEYWORD_NAMES));
+    vector<string> words = benchmark_words();
+    long long lookups = (long long)rounds * words.size();
+
+    for (const string& word : words)
+    {
+        if (binary_search_reserve(keyword_list, word) != keyword_lookup(word))
+        {
+            out << "keyword_lookup mismatch: " << word << endl;
+            return;
+        }
+    }
+
+    long long checksum = 0;
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+        for (const string& word : words)
+            checksum += binary_search_reserve(keyword_list, word);
+    auto middle = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+        for (const string& word : words)
+            checksum -= keyword_lookup(word);
+    auto finish = chrono::steady_clock::now();
+
+    double search_ns = chrono::duration<double, nano>(middle - start).count() / lookups;
+    double hash_ns = chrono::duration<double, nano>(finish - middle).count() / lookups;
+    out << "keyword lookups: " << lookups << " (checksum " << checksum << ")" << endl;
+    out << "binary search reserve: " << search_ns << " ns/lookup" << endl;
+    out << "perfect hash lookup:   " << hash_ns << " ns/lookup" << endl;
+    out << "speedup: " << search_ns / hash_ns << "x" << endl;
+}
+
+//原先的记号输出：每个记号用一个ostringstream拼接
+static string legacy_to_string(struct token token)
+{
+    ostringstream ostr;
+    ostr << "<" + to_string((word_type)token.type) + ", ";
+    if (token.type == CHAR)
+        ostr << token.value.c;
+    else if(token.type == INT || token.type == KEYWORD || token.type == ID || token.type == STRING)
+        ostr << token.value.i;
+    else if (token.type == UINT)
+        ostr << token.value.ui;
+    else if (token.type == LONG)
+        ostr << token.value.l;
+    else if (token.type == ULONG)
+        ostr << token.value.ul;
+    else if (token.type == FLOAT)
+        ostr << token.value.f;
+    else if (token.type == DOUBLE)
+        ostr << token.value.d;
+    else if (token.type == RELATION_OPERATOR || token.type == ASSIGN_OPERATOR)
+        ostr << to_string((word_type)token.value.i);
+    ostr << ">";
+    return ostr.str();
+}
+
+//原先main中的记号流输出：每个记号setw对齐，每行endl
+static void legacy_print_token_stream(ostream& out, const token_buffer& token_stream)
+{
+    token_buffer::const_iterator it = token_stream.begin();
+    for (size_t i = 0; i < token_stream.size();) {
+        for(int j = 0; j < 10 && i < token_stream.size(); j++, i++, ++it)
+            out << setiosflags(ios::left) << setw(11) << legacy_to_string(*it) << " ";
+        out << endl;
+    }
+}
+
+//只计算写入内容的FNV-1a哈希和字节数，不保存内容
+class hash_sink : public streambuf
+{
+public:
+    uint64_t hash = 14695981039346656037ull;
+    size_t bytes = 0;
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        if (c != traits_type::eof())
+            add((char)c);
+        return c;
+    }
+
+    streamsize xsputn(const char* s, streamsize n) override
+    {
+        for (streamsize i = 0; i < n; i++)
+            add(s[i]);
+        return n;
+    }
+
+private:
+    void add(char c)
+    {
+        hash = (hash ^ (unsigned char)c) * 1099511628211ull;
+        bytes++;
+    }
+};
+
+bool output_benchmark(ostream& out, const string& path)
+{
+    source_buffer program;
+    if (!open_source(program, path))
+        return false;
+    token_buffer token_stream;
+    symbol_table id_list, str_list;
+    int line_num = 0, char_num = 0;
+    vector<int> word_type_num(WORD_TYPE_AMOUNT);
+    ostringstream errors;
+    ostream* output = error_output;
+    error_output = &errors;
+
+    auto start = chrono::steady_clock::now();
+    lexical_analysis(token_stream, id_list, str_list, line_num, word_type_num, char_num, program);
+    auto lexed = chrono::steady_clock::now();
+    error_output = output;
+
+    hash_sink legacy_sink;
+    ostream legacy_out(&legacy_sink);
+    legacy_print_token_stream(legacy_out, token_stream);
+    auto legacy_printed = chrono::steady_clock::now();
+
+    hash_sink buffered_sink;
+    ostream buffered_out(&buffered_sink);
+    {
+        output_buffer buffer(buffered_out);
+        print_token_stream(buffer, token_stream);
+    }
+    auto buffered_printed = chrono::steady_clock::now();
+
+    double lex_s = chrono::duration<double>(lexed - start).count();
+    double legacy_s = chrono::duration<double>(legacy_printed - lexed).count();
+    double buffered_s = chrono::duration<double>(buffered_printed - legacy_printed).count();
+    double tokens = (double)token_stream.size();
+    out << "tokens: " << token_stream.size() << ", output bytes: " << buffered_sink.bytes << endl;
+    out << "output identical: " << (legacy_sink.hash == buffered_sink.hash && legacy_sink.bytes == buffered_sink.bytes ? "yes" : "no") << endl;
+    out << "lex only:              " << tokens / lex_s << " tokens/s" << endl;
+    out << "lex + legacy print:    " << tokens / (lex_s + legacy_s) << " tokens/s" << endl;
+    out << "lex + buffered print:  " << tokens / (lex_s + buffered_s) << " tokens/s" << endl;
+    out << "print speedup: " << legacy_s / buffered_s << "x" << endl;
+    return true;
+}
+
+//按main的格式把分析结果写为文本，用于比较文本输出的大小和速度
+static string text_output(const token_buffer& token_stream, const symbol_table& id_list, const symbol_table& str_list, int line_num, const vector<int>& word_type_num, int char_num)
+{
+    ostringstream text;
+    {
+        output_buffer output(text);
+        for (size_t i = 0; i < id_list.size(); i++) {
+            output.append_left(i, 10);
+            output.append(id_list[i]);
+            output.append('\n');
+        }
+        for (size_t i = 0; i < str_list.size(); i++) {
+            output.append_left(i, 10);
+            output.append(str_list[i]);
+            output.append('\n');
+        }
+        print_token_stream(output, token_stream);
+        for (size_t i = 0; i < word_type_num.size(); i++)
+        {
+            output.append_left(word_type_name((word_type)i), 14);
+            output.append(word_type_num[i]);
+            output.append('\n');
+        }
+        output.append(char_num);
+        output.append(line_num);
+    }
+    return text.str();
+}
+
+bool token_file_benchmark(ostream& out, const string& path)
+{
+    token_buffer token_stream;
+    symbol_table id_list, str_list;
+    int line_num = 0, char_num = 0;
+    vector<int> word_type_num(WORD_TYPE_AMOUNT);
+    ostringstream errors;
+    ostream* output = error_output;
+    error_output = &errors;
+    auto start = chrono::steady_clock::now();
+    {
+        source_buffer program;
+        if (!open_source(program, path))
+        {
+            error_output = output;
+            return false;
+        }
+        lexical_analysis(token_stream, id_list, str_list, line_num, word_type_num, char_num, program);
+    }
+    auto lexed = chrono::steady_clock::now();
+    error_output = output;
+
+    string text = text_output(token_stream, id_list, str_list, line_num, word_type_num, char_num);
+    auto text_written = chrono::steady_clock::now();
+    string binary;
+    encode_token_file(binary, token_stream, id_list, str_list, line_num, word_type_num, char_num);
+    auto binary_written = chrono::steady_clock::now();
+
+    string file_path = (filesystem::temp_directory_path() / "lexical_analysis_bench.tok").string();
+    if (!write_token_file(file_path, token_stream, id_list, str_list, line_num, word_type_num, char_num))
+    {
+        out << "cannot write " << file_path << endl;
+        return false;
+    }
+    auto read_start = chrono::steady_clock::now();
+    token_file file;
+    bool opened = file.open(file_path);
+    auto opened_time = chrono::steady_clock::now();
+    size_t iterated = 0;
+    for (token_file::const_iterator it = file.begin(); opened && it != file.end(); ++it)
+        iterated += (*it).type;
+    auto iterate_time = chrono::steady_clock::now();
+    token_buffer loaded_stream;
+    symbol_table loaded_id_list, loaded_str_list;
+    int loaded_line_num = 0, loaded_char_num = 0;
+    vector<int> loaded_word_type_num(WORD_TYPE_AMOUNT);
+    if (opened)
+        file.load(loaded_stream, loaded_id_list, loaded_str_list, loaded_line_num, loaded_word_type_num, loaded_char_num);
+    auto load_time = chrono::steady_clock::now();
+
+    string reencoded;
+    encode_token_file(reencoded, loaded_stream, loaded_id_list, loaded_str_list, loaded_line_num, loaded_word_type_num, loaded_char_num);
+    bool round_trip = opened && reencoded == binary
+        && text_output(loaded_stream, loaded_id_list, loaded_str_list, loaded_line_num, loaded_word_type_num, loaded_char_num) == text;
+    remove(file_path.c_str());
+
+    auto ms = [](chrono::steady_clock::time_point a, chrono::steady_clock::time_point b) { return chrono::duration<double, milli>(b - a).count(); };
+    out << "tokens: " << token_stream.size() << ", ID: " << id_list.size() << ", string: " << str_list.size() << endl;
+    out << "round trip: " << (round_trip ? "ok" : "FAILED") << endl;
+    out << "text output:   " << text.size() << " bytes, written in " << ms(lexed, text_written) << " ms" << endl;
+    out << "binary output: " << binary.size() << " bytes (" << (double)binary.size() / max(token_stream.size(), (size_t)1) << " per token, "
+        << (double)binary.size() / max(text.size(), (size_t)1) * 100 << "% of text), encoded in " << ms(text_written, binary_written) << " ms" << endl;
+    out << "lexical analysis: " << ms(start, lexed) << " ms" << endl;
+    out << "binary read: open and check " << ms(read_start, opened_time) << " ms, iterate " << ms(opened_time, iterate_time)
+        << " ms, load into token buffer and symbol tables " << ms(iterate_time, load_time) << " ms" << endl;
+    return round_trip;
+}
+
+//增量分析维护的全部结果
+struct incremental_state
+{
+    string program;
+    token_buffer token_stream;
+    symbol_table id_list;
+    symbol_table str_list;
+    int line_num = 0;
+    int char_num = 0;
+    vector<int> word_type_num = vector<int>(WORD_TYPE_AMOUNT);
+    vector<lexical_error> errors;
+};
+
+static void full_analysis(incremental_state& state)
+{
+    ostringstream discarded;
+    ostream* output = error_output;
+    vector<lexical_error>* log = error_log;
+    error_output = &discarded;
+    error_log = &state.errors;
+    source_buffer view;
+    view.data = state.program.data();
+    view.size = state.program.size();
+    lexical_analysis(state.token_stream, state.id_list, state.str_list, state.line_num, state.word_type_num, state.char_num, view);
+    error_output = output;
+    error_log = log;
+}
+
+//比较两次分析的结果，标志符和字符串的编号顺序可能不同，按内容和出现次数比较
+static bool same_analysis(const incremental_state& a, const incremental_state& b)
+{
+    if (a.token_stream.size() != b.token_stream.size() || a.line_num != b.line_num || a.char_num != b.char_num || a.word_type_num != b.word_type_num
+        || a.errors.size() != b.errors.size())
+        return false;
+    for (size_t i = 0; i < a.errors.size(); i++)
+        if (a.errors[i].offset != b.errors[i].offset || a.errors[i].word != b.errors[i].word)
+            return false;
+    token_buffer::const_iterator x = a.token_stream.begin(), y = b.token_stream.begin();
+    for (size_t i = 0; i < a.token_stream.size(); i++, ++x, ++y)
+    {
+        struct token s = *x, t = *y;
+        if (s.type != t.type || a.token_stream.offset(i) != b.token_stream.offset(i) || a.token_stream.length(i) != b.token_stream.length(i))
+            return false;
+        if (s.type == ID ? a.id_list[s.value.i] != b.id_list[t.value.i] || a.id_list.count(s.value.i) != b.id_list.count(t.value.i)
+            : s.type == STRING ? a.str_list[s.value.i] != b.str_list[t.value.i] || a.str_list.count(s.value.i) != b.str_list.count(t.value.i)
+            : to_string(s) != to_string(t))
+            return false;
+    }
+    for (int i = 0; i < KEYWORD_AMOUNT; i++)
+        if (a.id_list.keyword_count(i) != b.id_list.keyword_count(i))
+            return false;
+    return true;
+}
+
+bool incremental_benchmark(ostream& out, const string& path, int edits)
+{
+    source_buffer program;
+    if (!open_source(program, path))
+        return false;
+    incremental_state state;
+    state.program.assign(program.data, program.size);
+    close_source(program);
+    full_analysis(state);
+    size_t initial_tokens = state.token_stream.size();
+
+    //以键入标志符、空格、换行为主，偶尔键入会改变多行注释和字符串范围的字符
+    const string typed = "abcdefghijklmnopqrstuvwxyz_0123456789 \n;(){}=+-*/\"";
+    mt19937 random(12345);
+    vector<double> latencies;
+    size_t relexed = 0;
+    bool same = true;
+    for (int i = 0; i < edits && same; i++)
+    {
+        text_edit edit;
+        char inserted = typed[random() % typed.size()];
+        edit.offset = state.program.empty() ? 0 : random() % state.program.size();
+        edit.deleted = random() % 4 == 0 ? 1 : 0;
+        edit.inserted = edit.deleted ? string_view() : string_view(&inserted, 1);
+        auto start = chrono::steady_clock::now();
+        relex_range range = incremental_lexical_analysis(state.token_stream, state.id_list, state.str_list, state.line_num, state.word_type_num, state.char_num,
+            state.errors, state.program, edit);
+        auto finish = chrono::steady_clock::now();
+        latencies.push_back(chrono::duration<double, micro>(finish - start).count());
+        relexed += range.inserted;
+        if (i % 100 == 99 || i + 1 == edits)
+        {
+            incremental_state expected;
+            expected.program = state.program;
+            full_analysis(expected);
+            same = same_analysis(state, expected);
+            if (!same)
+                out << "edit " << i << " differs from full analysis" << endl;
+        }
+    }
+    auto full_start = chrono::steady_clock::now();
+    incremental_state expected;
+    expected.program = state.program;
+    full_analysis(expected);
+    double full_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - full_start).count();
+
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) { return latencies.empty() ? 0.0 : latencies[min(latencies.size() - 1, (size_t)(p * latencies.size()))]; };
+    out << "tokens: " << initial_tokens << ", lines: " << count(state.program.begin(), state.program.end(), '\n') + 1 << ", edits: " << latencies.size() << endl;
+    out << "matches full analysis: " << (same ? "yes" : "no") << endl;
+    out << "relex latency: p50 " << percentile(0.5) << " us, p99 " << percentile(0.99) << " us, max " << (latencies.empty() ? 0.0 : latencies.back()) << " us" << endl;
+    out << "average tokens relexed per edit: " << (latencies.empty() ? 0.0 : (double)relexed / latencies.size()) << endl;
+    out << "full analysis: " << full_ms << " ms" << endl;
+    return same;
+}
+
+//合成语料上一次完整分析的全部结果
+struct corpus_result
+{
+    token_buffer token_stream;
+    symbol_table id_list;
+    symbol_table str_list;
+    int line_num = 0;
+    int char_num = 0;
+    vector<int> word_type_num = vector<int>(WORD_TYPE_AMOUNT);
+};
+
+//重复rounds轮，每轮先执行不计时的prepare，再对run计时，返回最快一轮的秒数
+template <class Prepare, class Run>
+static double best_time(int rounds, Prepare prepare, Run run)
+{
+    double best = 0;
+    for (int i = 0; i < rounds; i++)
+    {
+        prepare();
+        auto start = chrono::steady_clock::now();
+        run();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (i == 0 || seconds < best)
+            best = seconds;
+    }
+    return best;
+}
+
+//用engine分析内存中的语料，词法错误写入只计数的流，与实际运行一样格式化错误信息
+template <class Engine>
+static double corpus_lexing_time(const string& corpus, int rounds, Engine engine)
+{
+    unique_ptr<corpus_result> result;
+    hash_sink sink;
+    ostream discarded(&sink);
+    ostream* output = error_output;
+    error_output = &discarded;
+    double seconds = best_time(rounds, [&] { result.reset(); result = make_unique<corpus_result>(); }, [&] {
+        source_buffer view;
+        view.data = corpus.data();
+        view.size = corpus.size();
+        engine(result->token_stream, result->id_list, result->str_list, result->line_num, result->word_type_num, result->char_num, view);
+    });
+    error_output = output;
+    return seconds;
+}
+
+//按lexical_analysis调用word_analysis时的方式还原单词内容：字符和字符串常量去掉引号，浮点常量去掉后缀
+static string_view word_content(word_type type, string_view text)
+{
+    switch (type)
+    {
+    case STRING:
+    case CHAR:
+        return text.size() >= 2 ? text.substr(1, text.size() - 2) : string_view();
+    case FLOAT:
+    case DOUBLE:
+        if (!text.empty() && (text.back() == 'f' || text.back() == 'F' || text.back() == 'l' || text.back() == 'L'))
+            text.remove_suffix(1);
+        return text;
+    default:
+        return text;
+    }
+}
+
+//重放word_analysis的一个单词
+struct replay_word
+{
+    word_type type;
+    size_t offset;
+    string_view content;
+};
+
+//输出一项测试的JSON对象和表格行，items为记号数或调用次数
+static void report_phase(ostream& json, ostream* text, const char* name, size_t bytes, size_t items, double seconds, bool whole, bool last)
+{
+    double ns = items ? seconds * 1e9 / items : 0.0;
+    json << "      \"" << name << "\": { ";
+    if (whole)
+        json << "\"ms\": " << seconds * 1e3 << ", \"mb_per_s\": " << bytes / seconds / 1e6 << ", \"tokens_per_s\": " << items / seconds << ", \"ns_per_token\": " << ns;
+    else
+        json << "\"calls\": " << items << ", \"ms\": " << seconds * 1e3 << ", \"ns_per_call\": " << ns;
+    json << " }" << (last ? "" : ",") << "\n";
+    if (text)
+    {
+        *text << "  " << left << setw(24) << name << right << setw(10) << seconds * 1e3 << " ms";
+        if (whole)
+            *text << setw(10) << bytes / seconds / 1e6 << " MB/s" << setw(14) << items / seconds << " tokens/s" << setw(8) << ns << " ns/token" << endl;
+        else
+            *text << setw(12) << items << " calls" << setw(8) << ns << " ns/call" << endl;
+    }
+}
+
+void corpus_benchmark(ostream& json, ostream* text, const vector<corpus_mix>& mixes, size_t size, uint32_t seed, int rounds)
+{
+    json << fixed << setprecision(3);
+    if (text)
+        *text << fixed << setprecision(2);
+    json << "{\n  \"benchmark\": \"corpus\",\n  \"built\": \"" << __DATE__ << " " << __TIME__ << "\",\n  \"scan_kernels\": \"" << scan->name
+        << "\",\n  \"corpus_size\": " << size << ",\n  \"seed\": " << seed << ",\n  \"rounds\": " << rounds << ",\n  \"results\": [\n";
+    for (size_t m = 0; m < mixes.size(); m++)
+    {
+        string corpus = generate_corpus(mixes[m], size, seed);
+
+        //不计时的一次分析，得到记号流和错误数，各阶段按记号流重放
+        corpus_result reference;
+        vector<lexical_error> errors;
+        {
+            hash_sink sink;
+            ostream discarded(&sink);
+            ostream* output = error_output;
+            vector<lexical_error>* log = error_log;
+            error_output = &discarded;
+            error_log = &errors;
+            source_buffer view;
+            view.data = corpus.data();
+            view.size = corpus.size();
+            lexical_analysis(reference.token_stream, reference.id_list, reference.str_list, reference.line_num, reference.word_type_num, reference.char_num, view);
+            error_output = output;
+            error_log = log;
+        }
+        size_t tokens = reference.token_stream.size();
+
+        //整型常量由number_analysis、关系和赋值运算符由operator_analysis加入记号流，其余记号都经过word_analysis
+        vector<string_view> names;                  //关键字和标志符，用于reserve
+        vector<pair<bool, string_view>> inserts;    //标志符（false）和字符串（true），用于table_insert
+        vector<replay_word> words;
+        token_buffer::const_iterator it = reference.token_stream.begin();
+        for (size_t i = 0; i < tokens; i++, ++it)
+        {
+            word_type type = (*it).type;
+            if (type == RELATION_OPERATOR || type == ASSIGN_OPERATOR || (type >= INT && type <= ULONG))
+                continue;
+            size_t offset = reference.token_stream.offset(i);
+            string_view content = word_content(type, string_view(corpus).substr(offset, reference.token_stream.length(i)));
+            if (type == KEYWORD || type == ID)
+            {
+                names.push_back(content);
+                if (type == ID)
+                    inserts.push_back({ false, content });
+                type = ID;
+            }
+            else if (type == STRING)
+                inserts.push_back({ true, content });
+            words.push_back({ type, offset, content });
+        }
+
+        double lexing = corpus_lexing_time(corpus, rounds, [](auto&... args) { lexical_analysis(args...); });
+        double table_lexing = corpus_lexing_time(corpus, rounds, [](auto&... args) { table_lexical_analysis(args...); });
+
+        int keywords = 0;
+        double reserve_time = best_time(rounds, [&] { keywords = 0; }, [&] {
+            for (string_view name : names)
+                keywords += keyword_lookup(name) >= 0;
+        });
+
+        unique_ptr<corpus_result> tables;
+        double insert_time = best_time(rounds, [&] { tables.reset(); tables = make_unique<corpus_result>(); }, [&] {
+            for (const pair<bool, string_view>& insert : inserts)
+                (insert.first ? tables->str_list : tables->id_list).insert(insert.second);
+        });
+
+        vector<struct token> token_stream;
+        token_stream.reserve(words.size());
+        hash_sink sink;
+        ostream discarded(&sink);
+        ostream* output = error_output;
+        error_output = &discarded;
+        double word_time = best_time(rounds, [&] { token_stream.clear(); tables.reset(); tables = make_unique<corpus_result>(); }, [&] {
+            for (const replay_word& word : words)
+                word_analysis(token_stream, tables->id_list, tables->str_list, tables->word_type_num, word.offset, word.type, word.content);
+        });
+        error_output = output;
+
+        json << "    {\n      \"mix\": \"" << corpus_mix_name(mixes[m]) << "\",\n      \"bytes\": " << corpus.size() << ",\n      \"lines\": " << reference.line_num
+            << ",\n      \"tokens\": " << tokens << ",\n      \"errors\": " << errors.size() << ",\n      \"ids\": " << reference.id_list.size()
+            << ",\n      \"strings\": " << reference.str_list.size() << ",\n      \"keywords\": " << keywords << ",\n";
+        if (text)
+            *text << corpus_mix_name(mixes[m]) << ": " << corpus.size() << " bytes, " << tokens << " tokens, " << errors.size() << " errors, "
+                << reference.id_list.size() << " IDs, " << reference.str_list.size() << " strings" << endl;
+        report_phase(json, text, "lexical_analysis", corpus.size(), tokens, lexing, true, false);
+        report_phase(json, text, "table_lexical_analysis", corpus.size(), tokens, table_lexing, true, false);
+        report_phase(json, text, "reserve", corpus.size(), names.size(), reserve_time, false, false);
+        report_phase(json, text, "table_insert", corpus.size(), inserts.size(), insert_time, false, false);
+        report_phase(json, text, "word_analysis", corpus.size(), words.size(), word_time, false, true);
+        json << "    }" << (m + 1 < mixes.size() ? "," : "") << "\n";
+    }
+    json << "  ]\n}" << endl;
+}
+
+bool session_benchmark(ostream& out, int files, size_t file_size)
+{
+    vector<string> sources;
+    size_t bytes = 0;
+    for (int i = 0; i < files; i++)
+    {
+        sources.push_back(generate_corpus((corpus_mix)(i % CORPUS_MIX_AMOUNT), file_size, i + 1));
+        bytes += sources.back().size();
+    }
+
+    const int rounds = 3;
+    ostream* output = error_output;
+    error_output = nullptr;
+
+    //每个文件新建全部结果，与原先的嵌入方式相同
+    size_t fresh_allocs = 0;
+    double fresh_time = best_time(rounds, [] {}, [&] {
+        size_t start = allocation_count();
+        for (const string& source : sources)
+        {
+            corpus_result result;
+            source_buffer view;
+            view.data = source.data();
+            view.size = source.size();
+            lexical_analysis(result.token_stream, result.id_list, result.str_list, result.line_num, result.word_type_num, result.char_num, view);
+        }
+        fresh_allocs = allocation_count() - start;
+    });
+
+    //先分析一遍预热，之后计时
+    lexer_session session;
+    for (const string& source : sources)
+        session.analyze(source);
+    size_t session_allocs = 0;
+    double session_time = best_time(rounds, [] {}, [&] {
+        size_t start = allocation_count();
+        for (const string& source : sources)
+            session.analyze(source);
+        session_allocs = allocation_count() - start;
+    });
+    error_output = output;
+
+    //逐个文件比较两种方式的结果
+    bool same = true;
+    for (size_t i = 0; i < sources.size() && same; i++)
+    {
+        corpus_result expected;
+        source_buffer view;
+        view.data = sources[i].data();
+        view.size = sources[i].size();
+        error_output = nullptr;
+        lexical_analysis(expected.token_stream, expected.id_list, expected.str_list, expected.line_num, expected.word_type_num, expected.char_num, view);
+        error_output = output;
+        session.analyze(sources[i]);
+        same = session.get_token_stream().size() == expected.token_stream.size() && session.get_line_num() == expected.line_num
+            && session.get_char_num() == expected.char_num && session.get_word_type_num() == expected.word_type_num
+            && session.get_id_list().size() == expected.id_list.size() && session.get_str_list().size() == expected.str_list.size();
+        for (size_t j = 0; same && j < expected.id_list.size(); j++)
+            same = session.get_id_list()[j] == expected.id_list[j];
+        token_buffer::const_iterator x = session.get_token_stream().begin(), y = expected.token_stream.begin();
+        for (size_t j = 0; same && j < expected.token_stream.size(); j++, ++x, ++y)
+            same = to_string(*x) == to_string(*y) && session.get_token_stream().offset(j) == expected.token_stream.offset(j);
+        if (!same)
+            out << "file " << i << " differs" << endl;
+    }
+
+    out << "files: " << files << ", bytes: " << bytes << endl;
+    out << "results identical: " << (same ? "yes" : "no") << endl;
+    out << "new results per file:  " << files / fresh_time << " files/s, " << bytes / fresh_time / 1e6 << " MB/s, "
+        << (double)fresh_allocs / files << " allocations per file" << endl;
+    out << "reused lexer_session:  " << files / session_time << " files/s, " << bytes / session_time / 1e6 << " MB/s, "
+        << (double)session_allocs / files << " allocations per file" << endl;
+    out << "speedup: " << fresh_time / session_time << "x" << endl;
+    return same;
+}
+
+//未给出源程序时生成的文件数和每个文件的字节数
+const int PREFETCH_BENCH_FILES = 4000;
+const size_t PREFETCH_BENCH_FILE_SIZE = 16 * 1024;
+
+//把files从页缓存中逐出，之后读取需要访问磁盘；平台不支持时返回false
+static bool evict_page_cache(const vector<string>& files)
+{
+#ifdef _WIN32
+    return false;
+#else
+    bool evicted = true;
+    for (const string& file : files)
+    {
+        int fd = open(file.c_str(), O_RDONLY);
+        if (fd < 0)
+            continue;
+        //脏页不能逐出，先写回
+        fdatasync(fd);
+        evicted = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0 && evicted;
+        close(fd);
+    }
+    return evicted;
+#endif
+}
+
+static bool same_statistics(const file_statistics& a, const file_statistics& b)
+{
+    return a.path == b.path && a.opened == b.opened && a.line_num == b.line_num && a.char_num == b.char_num && a.token_num == b.token_num
+        && a.id_num == b.id_num && a.str_num == b.str_num && a.word_type_num == b.word_type_num && a.errors == b.errors;
+}
+
+bool prefetch_benchmark(ostream& out, const vector<string>& paths, int thread_num, int rounds)
+{
+    vector<string> files = collect_sources(paths);
+    filesystem::path generated;
+    if (paths.empty())
+    {
+        generated = filesystem::temp_directory_path() / "lexical_analysis_prefetch";
+        filesystem::create_directories(generated);
+        for (int i = 0; i < PREFETCH_BENCH_FILES; i++)
+        {
+            files.push_back((generated / ("f" + to_string(i) + ".c")).string());
+            ofstream file(files.back(), ios::binary);
+            file << generate_corpus((corpus_mix)(i % CORPUS_MIX_AMOUNT), PREFETCH_BENCH_FILE_SIZE, i + 1);
+        }
+    }
+    size_t bytes = 0;
+    for (const string& file : files)
+    {
+        error_code ec;
+        bytes += filesystem::file_size(file, ec);
+    }
+    int threads = thread_num > 0 ? thread_num : max(1, (int)thread::hardware_concurrency());
+    vector<string> none;
+    prefetch_mode uring_mode = file_prefetcher(none, PREFETCH_URING).get_mode();
+
+    //各方式交替运行，每次运行前逐出页缓存，取最快的一次；CPU时间为整个进程（含读取线程和内核的io_uring线程）的CPU时间
+    double wall[PREFETCH_MODE_AMOUNT];
+    double cpu[PREFETCH_MODE_AMOUNT];
+    fill(wall, wall + PREFETCH_MODE_AMOUNT, 1e300);
+    vector<file_statistics> expected;
+    vector<file_statistics> results;
+    bool cold = true;
+    bool same = true;
+    for (int round = 0; round < rounds; round++)
+    {
+        for (int mode = 0; mode < PREFETCH_MODE_AMOUNT; mode++)
+        {
+            cold = evict_page_cache(files) && cold;
+            clock_t cpu_start = clock();
+            auto start = chrono::steady_clock::now();
+            batch_analysis(files, thread_num, false, results, nullptr, (prefetch_mode)mode);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            double cpu_seconds = (double)(clock() - cpu_start) / CLOCKS_PER_SEC;
+            if (seconds < wall[mode])
+            {
+                wall[mode] = seconds;
+                cpu[mode] = cpu_seconds;
+            }
+            if (expected.empty())
+                expected = results;
+            for (size_t i = 0; i < files.size() && same; i++)
+                same = same_statistics(results[i], expected[i]);
+        }
+    }
+    if (!generated.empty())
+    {
+        error_code ec;
+        filesystem::remove_all(generated, ec);
+    }
+
+    out << "files: " << files.size() << ", bytes: " << bytes << ", lexing threads: " << threads
+        << ", page cache: " << (cold ? "evicted before each run" : "not evicted (results are warm)") << endl;
+    out << "results identical: " << (same ? "yes" : "no") << endl;
+    out << setiosflags(ios::left) << setw(10) << "mode" << setw(12) << "wall ms" << setw(10) << "MB/s" << setw(12) << "CPU ms"
+        << setw(14) << "idle CPU ms" << "idle removed" << endl;
+    //空闲的CPU时间：分析线程数乘以耗时，减去进程实际使用的CPU时间
+    double off_idle = threads * wall[PREFETCH_OFF] - cpu[PREFETCH_OFF];
+    for (int mode = 0; mode < PREFETCH_MODE_AMOUNT; mode++)
+    {
+        double idle = threads * wall[mode] - cpu[mode];
+        string name(prefetch_mode_name((prefetch_mode)mode));
+        if (mode == PREFETCH_URING && uring_mode != PREFETCH_URING)
+            name += "*";
+        out << setw(10) << name << setw(12) << wall[mode] * 1e3 << setw(10) << bytes / wall[mode] / 1e6 << setw(12) << cpu[mode] * 1e3
+            << setw(14) << idle * 1e3 << (off_idle - idle) * 1e3 << " ms" << endl;
+    }
+    if (uring_mode != PREFETCH_URING)
+        out << "* io_uring is unavailable, the reader threads were used instead" << endl;
+    return same;
+}
+
+//只用一个互斥量保护的符号表，作为全局表并发插入的对照
+struct locked_symbol_table
+{
+    mutex lock;
+    symbol_table table;
+
+    uint32_t insert(string_view str)
+    {
+        lock_guard<mutex> guard(lock);
+        return table.insert(str);
+    }
+};
+
+//thread_num个线程同时把各文件的标志符插入table，第t个线程处理第t、t+thread_num、...个文件，返回秒数
+template <class Table>
+static double intern_time(Table& table, const vector<vector<string>>& file_ids, int thread_num)
+{
+    vector<thread> threads;
+    auto start = chrono::steady_clock::now();
+    for (int t = 0; t < thread_num; t++)
+    {
+        threads.emplace_back([&, t] {
+            for (size_t f = t; f < file_ids.size(); f += thread_num)
+                for (const string& id : file_ids[f])
+                    table.insert(id);
+        });
+    }
+    for (thread& t : threads)
+        t.join();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+bool intern_benchmark(ostream& out, int max_threads, int files, int rounds)
+{
+    //每个合成源程序中出现的不同标志符，与批量分析时插入全局表的内容相同
+    vector<vector<string>> file_ids(files);
+    symbol_table distinct;
+    size_t insertions = 0;
+    ostream* output = error_output;
+    error_output = nullptr;
+    for (int i = 0; i < files; i++)
+    {
+        string source = generate_corpus((corpus_mix)(i % CORPUS_MIX_AMOUNT), 16 * 1024, i + 1);
+        corpus_result result;
+        source_buffer view;
+        view.data = source.data();
+        view.size = source.size();
+        lexical_analysis(result.token_stream, result.id_list, result.str_list, result.line_num, result.word_type_num, result.char_num, view);
+        for (size_t j = 0; j < result.id_list.size(); j++)
+        {
+            file_ids[i].emplace_back(result.id_list[j]);
+            distinct.insert(result.id_list[j]);
+        }
+        insertions += result.id_list.size();
+    }
+    error_output = output;
+
+    if (max_threads <= 0)
+        max_threads = max(4, (int)thread::hardware_concurrency());
+    out << "files: " << files << ", insertions: " << insertions << ", distinct identifiers: " << distinct.size()
+        << ", hardware threads: " << thread::hardware_concurrency() << endl;
+    out << "first pass inserts into an empty table, second pass finds every identifier already present" << endl;
+    out << setiosflags(ios::left) << setw(9) << "threads" << setw(20) << "striped first M/s" << setw(21) << "striped second M/s"
+        << setw(18) << "mutex first M/s" << "mutex second M/s" << endl;
+
+    bool consistent = true;
+    for (int thread_num = 1; thread_num <= max_threads; thread_num *= 2)
+    {
+        double striped[2] = { 1e300, 1e300 };
+        double locked[2] = { 1e300, 1e300 };
+        for (int round = 0; round < rounds; round++)
+        {
+            concurrent_symbol_table table;
+            striped[0] = min(striped[0], intern_time(table, file_ids, thread_num));
+            striped[1] = min(striped[1], intern_time(table, file_ids, thread_num));
+            locked_symbol_table baseline;
+            locked[0] = min(locked[0], intern_time(baseline, file_ids, thread_num));
+            locked[1] = min(locked[1], intern_time(baseline, file_ids, thread_num));
+
+            //编号连续且不重复，每个标志符都能按编号取回
+            consistent = consistent && table.size() == distinct.size();
+            vector<bool> seen(table.size());
+            for (size_t i = 0; consistent && i < distinct.size(); i++)
+            {
+                int64_t id = table.find(distinct[i]);
+                consistent = id >= 0 && (size_t)id < seen.size() && !seen[id] && table[id] == distinct[i];
+                if (consistent)
+                    seen[id] = true;
+            }
+        }
+        out << setw(9) << thread_num << setw(20) << insertions / striped[0] / 1e6 << setw(21) << insertions / striped[1] / 1e6
+            << setw(18) << insertions / locked[0] / 1e6 << insertions / locked[1] / 1e6 << endl;
+        if (thread_num < max_threads && thread_num * 2 > max_threads)
+            thread_num = max_threads / 2;
+    }
+    out << "global IDs consistent: " << (consistent ? "yes" : "no") << endl;
+    return consistent;
+}
@@ -0,0 +1,85 @@
+﻿#pragma once
+#include <ostream>
+#include <string>
+#include <vector>
+#include "corpus_generator.h"
+
+/**
+ * 关键字识别微基准测试，比较完美哈希keyword_lookup与原先的二分搜索reserve
+ * std::ostream& out - 输出测试结果
+ * int rounds - 对测试单词表重复查找的轮数
+ */
+void keyword_benchmark(std::ostream& out, int rounds = 20000);
+
+/**
+ * 记号流输出基准测试，比较只做词法分析、分析后用原先的ostringstream和setw逐个输出、分析后用output_buffer输出三者的吞吐量
+ * 两种输出写入同一个只计算哈希的流，同时检查输出是否逐字节相同
+ * std::ostream& out - 输出测试结果
+ * const std::string& path - 源程序路径
+ * 成功返回true
+ */
+bool output_benchmark(std::ostream& out, const std::string& path);
+
+/**
+ * 二进制记号文件基准测试，比较记号文件与文本输出的大小、写入速度，以及从记号文件读回与重新分析源程序的速度
+ * 同时检查往返结果：读回的记号流、符号表和统计结果重新编码后与原记号文件逐字节相同，输出的文本也相同
+ * std::ostream& out - 输出测试结果
+ * const std::string& path - 源程序路径
+ * 成功返回true
+ */
+bool token_file_benchmark(std::ostream& out, const std::string& path);
+
+/**
+ * 增量分析基准测试，在源程序的随机位置逐个插入或删除字符，模拟键入，统计每次编辑重新分析的耗时
+ * 每隔一定次数将增量分析的结果与整体重新分析比较，标志符和字符串按内容比较
+ * std::ostream& out - 输出测试结果
+ * const std::string& path - 源程序路径
+ * int edits - 编辑次数
+ * 成功且结果一致返回true
+ */
+bool incremental_benchmark(std::ostream& out, const std::string& path, int edits = 2000);
+
+/**
+ * 合成语料吞吐量基准测试，对每种语料测试lexical_analysis和table_lexical_analysis整体的MB/s、tokens/s和ns/token，
+ * 以及reserve（关键字查找）、table_insert（符号表插入）、word_analysis三个阶段单独重放的每次调用耗时，各项取多轮中最快的一轮
+ * 结果以JSON写入json，便于保存后比较各版本的性能；text不为nullptr时另外输出便于阅读的表格
+ * const std::vector<corpus_mix>& mixes - 测试的语料类型
+ * size_t size - 每种语料的字节数
+ * uint32_t seed - 生成语料的随机种子
+ * int rounds - 每项测试的轮数
+ */
+void corpus_benchmark(std::ostream& json, std::ostream* text, const std::vector<corpus_mix>& mixes, size_t size, uint32_t seed, int rounds = 5);
+
+/**
+ * 连续分析大量小源程序的基准测试，比较每个文件新建记号流、符号表后调用lexical_analysis，与重复使用同一个lexer_session
+ * 输出两者的文件/秒、MB/s和平均每个文件的堆分配次数，同时检查两者的结果是否相同
+ * std::ostream& out - 输出测试结果
+ * int files - 文件数，各文件为不同种子生成的均衡合成语料
+ * size_t file_size - 每个文件的字节数
+ * 结果相同返回true
+ */
+bool session_benchmark(std::ostream& out, int files = 5000, size_t file_size = 4096);
+
+/**
+ * 预读基准测试，在冷页缓存上比较批量分析时各工作线程自己打开源程序、读取线程预读和io_uring预读三种方式
+ * 每次运行前用posix_fadvise把全部源程序逐出页缓存，输出各方式的耗时、MB/s、进程CPU时间和空闲的CPU时间（分析线程数乘以耗时减去CPU时间），
+ * 以及比自己打开源程序减少的空闲时间，同时检查各方式的结果是否相同
+ * std::ostream& out - 输出测试结果
+ * const std::vector<std::string>& paths - 源程序文件或目录（同--batch），为空时在临时目录中生成4000个16KB的合成源程序，结束后删除
+ * int thread_num - 分析线程数，为0时使用硬件并发数
+ * int rounds - 各方式交替运行的轮数，取最快的一次
+ * 结果相同返回true
+ */
+bool prefetch_benchmark(std::ostream& out, const std::vector<std::string>& paths, int thread_num, int rounds = 3);
+
+/**
+ * 全局标志符表的并发插入测试，1、2、4...直到max_threads个线程同时把各源程序中的不同标志符插入同一个表
+ * 比较分段加锁、不加锁查找的concurrent_symbol_table与只用一个互斥量保护的symbol_table，
+ * 分别输出空表插入（第一遍）和全部已存在时（第二遍）的每秒插入次数（百万），并检查全局编号是否连续、不重复且能取回原文
+ * std::ostream& out - 输出测试结果
+ * int max_threads - 最多的线程数，为0时使用硬件并发数，且至少为4
+ * int files - 合成源程序数，每个16KB
+ * int rounds - 每种线程数的轮数，取最快的一轮
+ * 编号一致返回true
+ */
+bool intern_benchmark(std::ostream& out, int max_threads, int files = 2000, int rounds = 3);
@@ -0,0 +1,89 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+/**
+ * 有界的无锁多生产者多消费者队列
+ * 每个槽带一个序号，生产者和消费者各用一个原子游标，以CAS领取槽位后写入或取出，再发布槽的序号；不使用锁，也不分配内存
+ * 槽的序号等于游标时可写入，等于游标加1时可取出；容量向上取整为2的幂
+ * 队列满时try_push、空时try_pop返回false，由调用者决定如何等待
+ */
+template <class T>
+class bounded_queue
+{
+public:
+    explicit bounded_queue(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        cells.reset(new cell[size]);
+        mask = size - 1;
+        for (size_t i = 0; i < size; i++)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bounded_queue(const bounded_queue&) = delete;
+    bounded_queue& operator=(const bounded_queue&) = delete;
+
+    bool try_push(const T& value)
+    {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        while (true)
+        {
+            cell& c = cells[pos & mask];
+            size_t sequence = c.sequence.load(std::memory_order_acquire);
+            if (sequence == pos)
+            {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    c.value = value;
+                    c.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (sequence < pos)
+                return false;                           //槽中上一轮的元素还未取出，队列已满
+            else
+                pos = tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    bool try_pop(T& value)
+    {
+        size_t pos = head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            cell& c = cells[pos & mask];
+            size_t sequence = c.sequence.load(std::memory_order_acquire);
+            if (sequence == pos + 1)
+            {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    value = c.value;
+                    c.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (sequence < pos + 1)
+                return false;                           //槽还未写入，队列为空
+            else
+                pos = head.load(std::memory_order_relaxed);
+        }
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> tail{ 0 };    //生产者的游标，与消费者的游标放在不同的缓存行
+    alignas(64) std::atomic<size_t> head{ 0 };
+};
@@ -0,0 +1,133 @@
+﻿#include "concurrent_symbol_table.h"
+#include "symbol_table.h"
+#include <cstring>
+
+using namespace std;
+
+//每个分段开始时的槽数
+const size_t STRIPE_INITIAL_SLOT_NUM = 64;
+
+concurrent_symbol_table::concurrent_symbol_table()
+    : stripes(new stripe[CONCURRENT_STRIPE_NUM]), segments(new atomic<entry*>[DIRECTORY_SEGMENT_NUM])
+{
+    for (int i = 0; i < CONCURRENT_STRIPE_NUM; i++)
+        stripes[i].table.store(new_array(stripes[i], STRIPE_INITIAL_SLOT_NUM), memory_order_relaxed);
+    for (size_t i = 0; i < DIRECTORY_SEGMENT_NUM; i++)
+        segments[i].store(nullptr, memory_order_relaxed);
+}
+
+concurrent_symbol_table::~concurrent_symbol_table()
+{
+    for (size_t i = 0; i < DIRECTORY_SEGMENT_NUM; i++)
+        delete[] segments[i].load(memory_order_relaxed);
+}
+
+concurrent_symbol_table::slot_array* concurrent_symbol_table::new_array(stripe& s, size_t size)
+{
+    unique_ptr<slot_array> array = make_unique<slot_array>();
+    array->mask = size - 1;
+    array->slots.reset(new atomic<uint64_t>[size]);
+    for (size_t i = 0; i < size; i++)
+        array->slots[i].store(0, memory_order_relaxed);
+    s.arrays.push_back(move(array));
+    return s.arrays.back().get();
+}
+
+/**
+ * 在槽数组中查找str，找到时返回编号，否则返回-1，pos为遇到的第一个空槽
+ * 槽以acquire读取，读到编号时表项的内容一定已经写好
+ */
+int64_t concurrent_symbol_table::probe(const slot_array& table, uint32_t h, string_view str, size_t& pos) const
+{
+    for (size_t i = h & table.mask; ; i = (i + 1) & table.mask)
+    {
+        uint64_t slot = table.slots[i].load(memory_order_acquire);
+        if (slot == 0)
+        {
+            pos = i;
+            return -1;
+        }
+        if ((uint32_t)(slot >> 32) != h)
+            continue;
+        uint32_t id = (uint32_t)slot - 1;
+        string_view entry = (*this)[id];
+        if (entry.size() == str.size() && memcmp(entry.data(), str.data(), str.size()) == 0)
+            return id;
+    }
+}
+
+concurrent_symbol_table::entry& concurrent_symbol_table::entry_at(uint32_t id)
+{
+    atomic<entry*>& segment = segments[id >> DIRECTORY_SEGMENT_BITS];
+    entry* entries = segment.load(memory_order_acquire);
+    if (!entries)
+    {
+        //不同分段的插入者可能同时用到新的一段，只有一个的分配生效
+        entry* created = new entry[(size_t)1 << DIRECTORY_SEGMENT_BITS];
+        if (segment.compare_exchange_strong(entries, created, memory_order_acq_rel))
+            entries = created;
+        else
+            delete[] created;
+    }
+    return entries[id & (((size_t)1 << DIRECTORY_SEGMENT_BITS) - 1)];
+}
+
+string_view concurrent_symbol_table::operator[](size_t id) const
+{
+    const entry& e = segments[id >> DIRECTORY_SEGMENT_BITS].load(memory_order_acquire)[id & (((size_t)1 << DIRECTORY_SEGMENT_BITS) - 1)];
+    return string_view(e.data, e.length);
+}
+
+int64_t concurrent_symbol_table::find(string_view str) const
+{
+    uint32_t h = symbol_table::hash(str);
+    const stripe& s = stripes[h >> (32 - CONCURRENT_STRIPE_BITS)];
+    size_t pos;
+    return probe(*s.table.load(memory_order_acquire), h, str, pos);
+}
+
+uint32_t concurrent_symbol_table::insert(string_view str)
+{
+    uint32_t h = symbol_table::hash(str);
+    stripe& s = stripes[h >> (32 - CONCURRENT_STRIPE_BITS)];
+    size_t pos;
+    int64_t found = probe(*s.table.load(memory_order_acquire), h, str, pos);
+    if (found >= 0)
+        return (uint32_t)found;
+
+    //加锁后在当前的槽数组中再查找一次，其间其他线程可能已插入或扩容
+    lock_guard<mutex> lock(s.mutex);
+    slot_array& table = *s.table.load(memory_order_relaxed);
+    found = probe(table, h, str, pos);
+    if (found >= 0)
+        return (uint32_t)found;
+
+    uint32_t id = count.fetch_add(1, memory_order_relaxed);
+    entry& e = entry_at(id);
+    e.data = s.text.data(s.text.store(str));
+    e.length = (uint32_t)str.size();
+    table.slots[pos].store((uint64_t)h << 32 | (id + 1), memory_order_release);
+
+    //装载因子超过1/2时扩容
+    if (++s.used * 2 > table.mask + 1)
+        grow(s);
+    return id;
+}
+
+//持有分段的锁时调用：把表项重新放入两倍大小的新数组后再发布
+void concurrent_symbol_table::grow(stripe& s)
+{
+    slot_array& old_table = *s.table.load(memory_order_relaxed);
+    slot_array* table = new_array(s, (old_table.mask + 1) * 2);
+    for (size_t i = 0; i <= old_table.mask; i++)
+    {
+        uint64_t slot = old_table.slots[i].load(memory_order_relaxed);
+        if (slot == 0)
+            continue;
+        size_t j = (slot >> 32) & table->mask;
+        while (table->slots[j].load(memory_order_relaxed) != 0)
+            j = (j + 1) & table->mask;
+        table->slots[j].store(slot, memory_order_relaxed);
+    }
+    s.table.store(table, memory_order_release);
+}
@@ -0,0 +1,79 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+#include "text_arena.h"
+
+//分段数（2的幂），按哈希值的高位选择分段
+constexpr int CONCURRENT_STRIPE_BITS = 6;
+constexpr int CONCURRENT_STRIPE_NUM = 1 << CONCURRENT_STRIPE_BITS;
+
+//编号目录每段的表项数和段数，编号不超过2^28
+constexpr int DIRECTORY_SEGMENT_BITS = 16;
+constexpr size_t DIRECTORY_SEGMENT_NUM = 4096;
+
+/**
+ * 多个线程可以同时插入的全局符号表，用于并行分析多个源程序时给整个项目的标志符统一编号
+ * 表按哈希值的高位分为CONCURRENT_STRIPE_NUM个分段，每段是一个开放定址的哈希表，槽中以一个64位原子数保存哈希值和编号：
+ * 查找不加锁，以acquire读取槽；未找到时才锁住该分段，再查找一次后插入，内容存入分段自己的文本区，表项登记到编号目录后，
+ * 最后以release写入槽发布；分段扩容时换用新的槽数组，旧数组保留到表销毁，正在不加锁查找的线程仍可安全读取
+ * 编号由全局计数器分配，从0开始连续，分配后不再改变，但多个线程同时插入时各标志符得到的编号与插入的先后有关
+ */
+class concurrent_symbol_table
+{
+public:
+    concurrent_symbol_table();
+    ~concurrent_symbol_table();
+
+    concurrent_symbol_table(const concurrent_symbol_table&) = delete;
+    concurrent_symbol_table& operator=(const concurrent_symbol_table&) = delete;
+
+    //查找str的编号，若不存在则插入，返回其编号
+    uint32_t insert(std::string_view str);
+
+    //查找str的编号，若不存在返回-1；已完成的插入一定能找到
+    int64_t find(std::string_view str) const;
+
+    //按编号取出表项，编号须由本线程的insert、find得到，或在插入它的线程结束之后使用
+    std::string_view operator[](size_t id) const;
+
+    //已分配的编号数，其他线程正在插入的表项可能已计入
+    size_t size() const { return count.load(std::memory_order_acquire); }
+
+private:
+    //编号目录中的表项，指向分段文本区中的内容
+    struct entry
+    {
+        const char* data;
+        uint32_t length;
+    };
+
+    //槽数组，槽为哈希值 << 32 | (编号 + 1)，0表示空槽
+    struct slot_array
+    {
+        size_t mask;
+        std::unique_ptr<std::atomic<uint64_t>[]> slots;
+    };
+
+    struct alignas(64) stripe
+    {
+        std::mutex mutex;                               //插入和扩容时持有
+        std::atomic<slot_array*> table{ nullptr };      //当前的槽数组
+        std::vector<std::unique_ptr<slot_array>> arrays;//当前和已换下的槽数组
+        size_t used = 0;
+        text_arena text;
+    };
+
+    int64_t probe(const slot_array& table, uint32_t h, std::string_view str, size_t& pos) const;
+    entry& entry_at(uint32_t id);
+    static slot_array* new_array(stripe& s, size_t size);
+    void grow(stripe& s);
+
+    std::unique_ptr<stripe[]> stripes;
+    std::unique_ptr<std::atomic<entry*>[]> segments;   //编号目录，按编号的高位分为固定大小的段，段在第一次用到时分配
+    std::atomic<uint32_t> count{ 0 };
+};
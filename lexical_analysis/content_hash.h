@@ -0,0 +1,9 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * 计算data的XXH64哈希值，结果与xxHash的XXH64相同
+ * 每次处理32字节，吞吐量远高于词法分析，用作词法分析缓存的键
+ */
+uint64_t content_hash(const void* data, size_t size, uint64_t seed = 0);
@@ -0,0 +1,455 @@
+﻿#include "corpus_generator.h"
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+
+const string_view CORPUS_MIX_NAMES[CORPUS_MIX_AMOUNT] = { "balanced", "identifier", "number", "comment", "string", "error" };
+
+//函数体内各类语句的权重：标志符表达式、数值常量、注释、字符串和字符常量、错误单词、控制语句
+enum statement_kind { ID_STATEMENT, NUMBER_STATEMENT, COMMENT_STATEMENT, STRING_STATEMENT, ERROR_STATEMENT, CONTROL_STATEMENT, STATEMENT_KIND_AMOUNT };
+
+const int STATEMENT_WEIGHTS[CORPUS_MIX_AMOUNT][STATEMENT_KIND_AMOUNT] = {
+    { 40, 15, 10, 10, 0, 25 },  //balanced
+    { 75, 3, 2, 2, 0, 18 },     //identifier
+    { 15, 70, 3, 2, 0, 10 },    //number
+    { 15, 5, 65, 5, 0, 10 },    //comment
+    { 12, 3, 5, 70, 0, 10 },    //string
+    { 25, 15, 5, 10, 35, 10 },  //error
+};
+
+const size_t VOCABULARY_SIZE = 2048;
+
+string_view corpus_mix_name(corpus_mix mix)
+{
+    return mix >= 0 && mix < CORPUS_MIX_AMOUNT ? CORPUS_MIX_NAMES[mix] : "unknown";
+}
+
+bool parse_corpus_mix(string_view name, corpus_mix& mix)
+{
+    for (int i = 0; i < CORPUS_MIX_AMOUNT; i++)
+        if (CORPUS_MIX_NAMES[i] == name)
+        {
+            mix = (corpus_mix)i;
+            return true;
+        }
+    return false;
+}
+
+//xorshift32伪随机数生成器，不使用<random>的分布以保证各平台结果相同
+class corpus_random
+{
+public:
+    explicit corpus_random(uint32_t seed) : state(seed ? seed : 0x9E3779B9u) {}
+
+    uint32_t next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    //[0, n)中的随机数
+    uint32_t below(uint32_t n) { return next() % n; }
+
+    template <size_t N>
+    const char* pick(const char* const (&list)[N]) { return list[below(N)]; }
+
+private:
+    uint32_t state;
+};
+
+class corpus_writer
+{
+public:
+    corpus_writer(corpus_mix mix, uint32_t seed) : mix(mix), random(seed)
+    {
+        make_vocabulary();
+    }
+
+    string generate(size_t size)
+    {
+        out.reserve(size + 4096);
+        while (out.size() < size)
+        {
+            if (random.below(8) == 0)
+                struct_definition();
+            function_definition();
+        }
+        return move(out);
+    }
+
+private:
+    //由音节拼接出不同长度的标志符，少量带下划线和数字，类似实际程序中的命名
+    void make_vocabulary()
+    {
+        static const char* const syllables[] = { "ba", "ce", "di", "fo", "gu", "ha", "ke", "li", "mo", "nu", "pa", "re", "si", "to", "vu",
+            "buf", "len", "cnt", "idx", "ptr", "node", "next", "val", "tmp", "key", "str", "num", "pos", "size", "data" };
+        vocabulary.push_back("i");
+        vocabulary.push_back("j");
+        vocabulary.push_back("n");
+        while (vocabulary.size() < VOCABULARY_SIZE)
+        {
+            string name = random.pick(syllables);
+            int parts = random.below(3);
+            for (int i = 0; i < parts; i++)
+            {
+                if (random.below(3) == 0)
+                    name += '_';
+                name += random.pick(syllables);
+            }
+            if (random.below(6) == 0)
+                name += to_string(random.below(100));
+            vocabulary.push_back(name);
+        }
+    }
+
+    //前面的标志符出现得更频繁，接近实际程序中少数名字反复出现的分布
+    const string& identifier()
+    {
+        uint32_t r = random.below(VOCABULARY_SIZE);
+        return vocabulary[r * (uint64_t)r / VOCABULARY_SIZE];
+    }
+
+    void indent(int depth)
+    {
+        out.append(depth * 4, ' ');
+    }
+
+    void operand()
+    {
+        switch (random.below(6))
+        {
+        case 0:     out += identifier(); out += "->"; out += identifier(); break;
+        case 1:     out += identifier(); out += '['; out += identifier(); out += ']'; break;
+        case 2:     out += identifier(); out += '.'; out += identifier(); break;
+        case 3:     number(); break;
+        default:    out += identifier(); break;
+        }
+    }
+
+    void expression(int operands)
+    {
+        static const char* const operators[] = { " + ", " - ", " * ", " / ", " % ", " & ", " | ", " ^ ", " << ", " >> ", " && ", " || ",
+            " < ", " <= ", " > ", " >= ", " == ", " != " };
+        if (random.below(8) == 0)
+            out += '!';
+        operand();
+        for (int i = 1; i < operands; i++)
+        {
+            out += random.pick(operators);
+            operand();
+        }
+    }
+
+    void call(int depth)
+    {
+        indent(depth);
+        out += identifier();
+        out += '(';
+        int args = random.below(4);
+        for (int i = 0; i < args; i++)
+        {
+            if (i)
+                out += ", ";
+            if (random.below(4) == 0)
+                out += '&';
+            out += identifier();
+        }
+        out += ");\n";
+    }
+
+    void id_statement(int depth)
+    {
+        static const char* const assigns[] = { " = ", " = ", " = ", " += ", " -= ", " *= ", " /= ", " %= ", " &= ", " |= ", " ^= ", " <<= ", " >>= " };
+        static const char* const types[] = { "int ", "char ", "long ", "unsigned int ", "float ", "double " };
+        switch (random.below(5))
+        {
+        case 0:
+            call(depth);
+            return;
+        case 1:
+            indent(depth);
+            if (random.below(4) == 0)
+            {
+                out += "struct ";
+                out += identifier();
+                out += "* ";
+            }
+            else
+                out += random.pick(types);
+            out += identifier();
+            break;
+        case 2:
+            indent(depth);
+            out += identifier();
+            out += random.below(2) ? "++" : "--";
+            out += ";\n";
+            return;
+        default:
+            indent(depth);
+            operand();
+            out += random.pick(assigns);
+            expression(1 + random.below(4));
+            if (random.below(6) == 0)
+            {
+                out += " ? ";
+                operand();
+                out += " : ";
+                operand();
+            }
+            out += ";\n";
+            return;
+        }
+        if (random.below(2))
+        {
+            out += " = ";
+            expression(1 + random.below(3));
+        }
+        out += ";\n";
+    }
+
+    void number()
+    {
+        static const char* const int_suffixes[] = { "", "", "", "u", "l", "ul", "U", "L", "UL" };
+        char digits[32];
+        switch (random.below(8))
+        {
+        case 0:     //八进制
+            out += '0';
+            out += to_string(1 + random.below(7));
+            out += to_string(random.below(8));
+            break;
+        case 1:     //十六进制
+            snprintf(digits, sizeof(digits), "0x%x", random.next() >> 1);
+            out += digits;
+            break;
+        case 2:     //小数点在末尾或开头
+            out += random.below(2) ? to_string(random.below(1000)) + "." : "." + to_string(random.below(1000));
+            return;
+        case 3:     //指数
+            snprintf(digits, sizeof(digits), "%u.%uE%s%u", random.below(100), random.below(100), random.below(2) ? "+" : "-", random.below(30));
+            out += digits;
+            out += random.below(3) == 0 ? "l" : "";
+            return;
+        case 4:     //带后缀的浮点数
+            snprintf(digits, sizeof(digits), "%u.%u", random.below(1000), random.below(1000));
+            out += digits;
+            out += random.below(2) ? "f" : "L";
+            return;
+        default:    //十进制
+            out += to_string(random.below(random.below(4) == 0 ? 2000000000u : 100));
+            break;
+        }
+        out += random.pick(int_suffixes);
+    }
+
+    void number_statement(int depth)
+    {
+        indent(depth);
+        out += identifier();
+        out += " = ";
+        number();
+        int more = random.below(4);
+        for (int i = 0; i < more; i++)
+        {
+            out += random.below(2) ? " + " : " * ";
+            number();
+        }
+        out += ";\n";
+    }
+
+    void comment(int depth)
+    {
+        static const char* const words[] = { "the", "buffer", "is", "checked", "before", "each", "token", "update", "length", "of",
+            "TODO:", "fix", "when", "empty", "这是", "一条", "注释", "(see", "above)", "*", "/", "\"quoted\"", "x++;" };
+        indent(depth);
+        bool block = random.below(3) == 0;
+        out += block ? "/*" : "//";
+        int lines = block ? 1 + random.below(5) : 1;
+        for (int line = 0; line < lines; line++)
+        {
+            if (line)
+            {
+                out += '\n';
+                indent(depth);
+                out += "   ";
+            }
+            int n = 3 + random.below(10);
+            for (int i = 0; i < n; i++)
+            {
+                out += ' ';
+                out += random.pick(words);
+            }
+        }
+        out += block ? " */\n" : "\n";
+    }
+
+    void string_literal()
+    {
+        static const char* const pieces[] = { "value", " ", "%d", "%s", "\\n", "\\t", "\\\"", "error: ", "ok", "line ", "字符串", ", ", "\\x41" };
+        out += '"';
+        int n = random.below(8);
+        for (int i = 0; i < n; i++)
+            out += random.pick(pieces);
+        out += '"';
+    }
+
+    void char_literal()
+    {
+        static const char* const chars[] = { "'a'", "'Z'", "'0'", "' '", "'\\n'", "'\\t'", "'\\0'", "'\\''", "'\\\"'", "'\\x41'", "'\\xff'", "'\\101'" };
+        out += random.pick(chars);
+    }
+
+    void string_statement(int depth)
+    {
+        indent(depth);
+        if (random.below(3) == 0)
+        {
+            out += identifier();
+            out += " = ";
+            char_literal();
+        }
+        else
+        {
+            out += random.below(2) ? "printf(" : "puts(";
+            string_literal();
+            if (random.below(2))
+            {
+                out += ", ";
+                out += identifier();
+            }
+            out += ')';
+        }
+        out += ";\n";
+    }
+
+    //program.txt中出现的各种词法错误
+    void error_statement(int depth)
+    {
+        static const char* const errors[] = { "09", "0xr", "1.2Ea", "1.3E+a", "'\\x100'", "'\\400'", "0x", "0189", "99999999999999999999",
+            "4294967296u", "1.e", "2.5E-q" };
+        indent(depth);
+        out += identifier();
+        out += random.below(2) ? " = " : " += ";
+        out += random.pick(errors);
+        out += ";\n";
+    }
+
+    void control_statement(int depth)
+    {
+        indent(depth);
+        switch (random.below(depth >= 4 ? 1 : 4))
+        {
+        case 0:
+            out += "return ";
+            expression(1 + random.below(2));
+            out += ";\n";
+            return;
+        case 1:
+            out += "if (";
+            expression(1 + random.below(3));
+            out += ")\n";
+            break;
+        case 2:
+            out += "while (";
+            expression(1 + random.below(3));
+            out += ")\n";
+            break;
+        default:
+            out += "for (";
+            out += identifier();
+            out += " = 0; ";
+            out += identifier();
+            out += " < ";
+            operand();
+            out += "; ";
+            out += identifier();
+            out += "++)\n";
+            break;
+        }
+        block(depth, 1 + random.below(4));
+    }
+
+    void statement(int depth)
+    {
+        const int* weights = STATEMENT_WEIGHTS[mix];
+        int total = 0;
+        for (int i = 0; i < STATEMENT_KIND_AMOUNT; i++)
+            total += weights[i];
+        int r = random.below(total);
+        int kind = 0;
+        while (r >= weights[kind])
+            r -= weights[kind++];
+        switch (kind)
+        {
+        case ID_STATEMENT:      id_statement(depth);        break;
+        case NUMBER_STATEMENT:  number_statement(depth);    break;
+        case COMMENT_STATEMENT: comment(depth);             break;
+        case STRING_STATEMENT:  string_statement(depth);    break;
+        case ERROR_STATEMENT:   error_statement(depth);     break;
+        default:                control_statement(depth);   break;
+        }
+    }
+
+    void block(int depth, int statements)
+    {
+        indent(depth);
+        out += "{\n";
+        for (int i = 0; i < statements; i++)
+            statement(depth + 1);
+        indent(depth);
+        out += "}\n";
+    }
+
+    void struct_definition()
+    {
+        static const char* const types[] = { "int", "char", "long", "float", "double", "unsigned long" };
+        out += "struct ";
+        out += identifier();
+        out += "\n{\n";
+        int fields = 1 + random.below(5);
+        for (int i = 0; i < fields; i++)
+        {
+            out += "    ";
+            out += random.pick(types);
+            out += ' ';
+            out += identifier();
+            out += ";\n";
+        }
+        out += "};\n\n";
+    }
+
+    void function_definition()
+    {
+        static const char* const types[] = { "int", "void", "char", "long", "double", "unsigned int" };
+        out += random.pick(types);
+        out += ' ';
+        out += identifier();
+        out += '(';
+        int params = random.below(4);
+        for (int i = 0; i < params; i++)
+        {
+            if (i)
+                out += ", ";
+            out += random.pick(types);
+            out += ' ';
+            out += identifier();
+        }
+        out += ")\n";
+        block(0, 4 + random.below(12));
+        out += '\n';
+    }
+
+    corpus_mix mix;
+    corpus_random random;
+    vector<string> vocabulary;
+    string out;
+};
+
+string generate_corpus(corpus_mix mix, size_t size, uint32_t seed)
+{
+    corpus_writer writer(mix, seed);
+    return writer.generate(size);
+}
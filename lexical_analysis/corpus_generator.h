@@ -0,0 +1,35 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+//合成语料中各类单词的比例
+enum corpus_mix
+{
+    BALANCED_MIX,       //接近普通C程序的混合
+    IDENTIFIER_MIX,     //以标志符和关键字为主
+    NUMBER_MIX,         //以各种进制、后缀的整型和浮点常量为主
+    COMMENT_MIX,        //以单行和多行注释为主
+    STRING_MIX,         //以字符串和字符常量（含转义）为主
+    ERROR_MIX,          //大量program.txt中的错误单词，如09、0xr、1.2Ea、'\x100'
+    CORPUS_MIX_AMOUNT
+};
+
+//基准测试默认的语料字节数
+constexpr size_t DEFAULT_CORPUS_SIZE = 8 << 20;
+
+//语料类型的名称，用于命令行和基准测试结果
+std::string_view corpus_mix_name(corpus_mix mix);
+
+//按名称查找语料类型，找不到时返回false
+bool parse_corpus_mix(std::string_view name, corpus_mix& mix);
+
+/**
+ * 生成可复现的合成C语料：由函数定义组成，函数体内的语句按mix的比例生成
+ * 使用自带的伪随机数生成器，相同的mix、size和seed在任何平台上生成的内容都相同
+ * corpus_mix mix - 语料类型
+ * size_t size - 目标字节数，生成到不小于size的第一个完整函数为止
+ * uint32_t seed - 随机种子
+ */
+std::string generate_corpus(corpus_mix mix, size_t size, uint32_t seed = 1);
@@ -0,0 +1,460 @@
+﻿#pragma once
+#include "token.h"
+
+/**
+ * 表驱动DFA
+ * 状态0-29与lexical_analysis中switch各状态含义相同，另外拆分出几个状态：
+ * switch中需要再读一个字符才能确定的后缀、转义和双字符运算符，在表中都是独立的状态
+ * 转移表和动作表在编译期由make_dfa_table生成
+ */
+
+//字符类别
+enum char_class : unsigned char
+{
+    CC_LETTER,          //除下列字母外的字母
+    CC_HEX_LETTER,      //a-d、A-D
+    CC_E,               //e、E
+    CC_F,               //f、F
+    CC_L,               //l、L
+    CC_U,               //u、U
+    CC_X,               //x、X
+    CC_UNDERSCORE,      //_
+    CC_DOLLAR,          //$
+    CC_ZERO,            //0
+    CC_OCT_DIGIT,       //1-7
+    CC_DEC_DIGIT,       //8、9
+    CC_DOT,             //.
+    CC_QUOTE,           //'
+    CC_DOUBLE_QUOTE,    //"
+    CC_BACKSLASH,       //反斜杠
+    CC_LESS,            //<
+    CC_GREATER,         //>
+    CC_EQUAL,           //=
+    CC_EXCLAMATION,     //!
+    CC_PLUS,            //+
+    CC_MINUS,           //-
+    CC_STAR,            //*
+    CC_SLASH,           ///
+    CC_PERCENT,         //%
+    CC_AMPERSAND,       //&
+    CC_BAR,             //|
+    CC_CARET,           //^
+    CC_PUNCTUATION,     //~ ? : ; [ ] ( ) { } ,，各自直接对应一个单词类型
+    CC_SPACE,           //空格、制表符
+    CC_NEWLINE,         //换行
+    CC_EOF,             //文件结束符，与switch一致，值为0xff的字节也视为EOF
+    CC_OTHER,           //其他字符
+    CHAR_CLASS_AMOUNT
+};
+
+//DFA状态，0-29为switch中的状态
+enum dfa_state : unsigned char
+{
+    DFA_START = 0,
+    DFA_ID = 1,
+    DFA_DECIMAL = 2,
+    DFA_ZERO = 3,
+    DFA_OCTAL = 4,
+    DFA_HEX_PREFIX = 5,
+    DFA_HEX = 6,
+    DFA_BAD_OCTAL = 7,
+    DFA_FRACTION = 8,
+    DFA_EXPONENT = 9,
+    DFA_EXPONENT_SIGN = 10,
+    DFA_EXPONENT_DIGIT = 11,
+    DFA_CHAR = 12,
+    DFA_STRING = 13,
+    DFA_LESS = 14,
+    DFA_GREATER = 15,
+    DFA_EQUAL = 16,
+    DFA_EXCLAMATION = 17,
+    DFA_PLUS = 18,
+    DFA_MINUS = 19,
+    DFA_STAR = 20,
+    DFA_SLASH = 21,
+    DFA_LINE_COMMENT = 22,
+    DFA_BLOCK_COMMENT = 23,
+    DFA_BLOCK_COMMENT_STAR = 24,
+    DFA_PERCENT = 25,
+    DFA_AMPERSAND = 26,
+    DFA_BAR = 27,
+    DFA_CARET = 28,
+    DFA_DOT = 29,
+    DFA_U_SUFFIX = 30,          //整型常量读到u，等待l
+    DFA_L_SUFFIX = 31,          //整型常量读到l，等待u
+    DFA_CHAR_ESCAPE = 32,       //字符常量中上一个字符为反斜杠
+    DFA_STRING_ESCAPE = 33,     //字符串常量中上一个字符为反斜杠
+    DFA_LSHIFT = 34,            //<<
+    DFA_RSHIFT = 35,            //>>
+    DFA_STATE_AMOUNT
+};
+
+//转移时的动作
+enum dfa_action : unsigned char
+{
+    DFA_APPEND = 1,             //将读入的字符加入当前单词
+    DFA_RETRACT = 2,            //回退读入的字符
+    DFA_NEWLINE = 4,            //行数加一
+    DFA_BEGIN = 8,              //回到状态0，开始识别新单词
+    DFA_SIMPLE = 16,            //除可能的DFA_APPEND外没有其他动作和输出，也不累加整型常量，驱动循环可直接转移
+};
+
+//转移时输出的内容
+enum dfa_emit : unsigned char
+{
+    EMIT_NONE,
+    EMIT_WORD,                  //不带属性的记号
+    EMIT_PUNCTUATION,           //单字符界符，单词类型由读入的字符决定
+    EMIT_LEXEME,                //以当前单词为属性的记号（标志符、实型常量）
+    EMIT_QUOTED,                //去掉开头引号的当前单词（字符常量、字符串常量）
+    EMIT_NUMBER,                //整型常量
+    EMIT_OPERATOR,              //关系运算符、赋值运算符
+    EMIT_ERROR,                 //报告词法错误
+    EMIT_END,                   //分析结束
+};
+
+struct dfa_entry
+{
+    unsigned char next;         //下一个状态
+    unsigned char action;       //dfa_action的组合
+    unsigned char emit;         //dfa_emit
+    unsigned char type;         //输出记号的word_type
+    unsigned char attribute;    //关系运算符、赋值运算符的属性
+};
+
+struct dfa_table
+{
+    dfa_entry entry[DFA_STATE_AMOUNT][CHAR_CLASS_AMOUNT];
+    unsigned char char_class[256];              //字节对应的字符类别
+    word_type punctuation[256];                 //CC_PUNCTUATION类字符对应的单词类型
+    unsigned char push_base[DFA_STATE_AMOUNT];  //进入该状态时读入的数字按几进制累加到整型常量，0表示不累加
+};
+
+constexpr dfa_entry dfa_go(int next, int action = 0)
+{
+    return { (unsigned char)next, (unsigned char)(action | (next == DFA_START ? DFA_BEGIN : 0)), EMIT_NONE, 0, 0 };
+}
+
+constexpr dfa_entry dfa_emit_word(int emit, word_type type, int action = 0, word_type attribute = KEYWORD)
+{
+    return { DFA_START, (unsigned char)(action | DFA_BEGIN), (unsigned char)emit, (unsigned char)type, (unsigned char)attribute };
+}
+
+constexpr dfa_entry dfa_operator(word_type type, word_type attribute, int action = 0)
+{
+    return dfa_emit_word(EMIT_OPERATOR, type, action, attribute);
+}
+
+constexpr dfa_entry dfa_error()
+{
+    return dfa_emit_word(EMIT_ERROR, KEYWORD, DFA_RETRACT);
+}
+
+constexpr void dfa_set_all(dfa_table& table, int state, dfa_entry entry)
+{
+    for (int cc = 0; cc < CHAR_CLASS_AMOUNT; cc++)
+        table.entry[state][cc] = entry;
+}
+
+constexpr void dfa_set_digits(dfa_table& table, int state, dfa_entry entry)
+{
+    table.entry[state][CC_ZERO] = entry;
+    table.entry[state][CC_OCT_DIGIT] = entry;
+    table.entry[state][CC_DEC_DIGIT] = entry;
+}
+
+constexpr void dfa_set_letters(dfa_table& table, int state, dfa_entry entry)
+{
+    const int letters[] = { CC_LETTER, CC_HEX_LETTER, CC_E, CC_F, CC_L, CC_U, CC_X };
+    for (int cc : letters)
+        table.entry[state][cc] = entry;
+}
+
+//整型常量的u、l后缀
+constexpr void dfa_set_suffix(dfa_table& table, int state)
+{
+    table.entry[state][CC_U] = dfa_go(DFA_U_SUFFIX);
+    table.entry[state][CC_L] = dfa_go(DFA_L_SUFFIX);
+}
+
+//字符常量、字符串常量，quote_state为上一个字符不是反斜杠的状态，escape_state为上一个字符是反斜杠的状态
+constexpr void dfa_set_quoted(dfa_table& table, int quote_state, int escape_state, int quote, word_type type)
+{
+    dfa_set_all(table, quote_state, dfa_go(quote_state, DFA_APPEND));
+    table.entry[quote_state][quote] = dfa_emit_word(EMIT_QUOTED, type);
+    table.entry[quote_state][CC_BACKSLASH] = dfa_go(escape_state, DFA_APPEND);
+    table.entry[quote_state][CC_NEWLINE] = dfa_error();
+    table.entry[quote_state][CC_EOF] = dfa_error();
+
+    //反斜杠后的引号不结束常量
+    dfa_set_all(table, escape_state, dfa_go(quote_state, DFA_APPEND));
+    table.entry[escape_state][CC_BACKSLASH] = dfa_go(escape_state, DFA_APPEND);
+    table.entry[escape_state][CC_NEWLINE] = dfa_error();
+    table.entry[escape_state][CC_EOF] = dfa_error();
+}
+
+constexpr dfa_table make_dfa_table()
+{
+    dfa_table table = {};
+
+    for (int ch = 0; ch < 256; ch++)
+    {
+        table.char_class[ch] = CC_OTHER;
+        table.punctuation[ch] = KEYWORD;
+    }
+    for (int ch = 'a'; ch <= 'z'; ch++)
+    {
+        table.char_class[ch] = CC_LETTER;
+        table.char_class[ch - 'a' + 'A'] = CC_LETTER;
+    }
+    for (int ch = 'a'; ch <= 'd'; ch++)
+    {
+        table.char_class[ch] = CC_HEX_LETTER;
+        table.char_class[ch - 'a' + 'A'] = CC_HEX_LETTER;
+    }
+    table.char_class['e'] = table.char_class['E'] = CC_E;
+    table.char_class['f'] = table.char_class['F'] = CC_F;
+    table.char_class['l'] = table.char_class['L'] = CC_L;
+    table.char_class['u'] = table.char_class['U'] = CC_U;
+    table.char_class['x'] = table.char_class['X'] = CC_X;
+    table.char_class['_'] = CC_UNDERSCORE;
+    table.char_class['$'] = CC_DOLLAR;
+    table.char_class['0'] = CC_ZERO;
+    for (int ch = '1'; ch <= '7'; ch++)
+        table.char_class[ch] = CC_OCT_DIGIT;
+    table.char_class['8'] = table.char_class['9'] = CC_DEC_DIGIT;
+    table.char_class['.'] = CC_DOT;
+    table.char_class['\''] = CC_QUOTE;
+    table.char_class['"'] = CC_DOUBLE_QUOTE;
+    table.char_class['\\'] = CC_BACKSLASH;
+    table.char_class['<'] = CC_LESS;
+    table.char_class['>'] = CC_GREATER;
+    table.char_class['='] = CC_EQUAL;
+    table.char_class['!'] = CC_EXCLAMATION;
+    table.char_class['+'] = CC_PLUS;
+    table.char_class['-'] = CC_MINUS;
+    table.char_class['*'] = CC_STAR;
+    table.char_class['/'] = CC_SLASH;
+    table.char_class['%'] = CC_PERCENT;
+    table.char_class['&'] = CC_AMPERSAND;
+    table.char_class['|'] = CC_BAR;
+    table.char_class['^'] = CC_CARET;
+    table.char_class[' '] = table.char_class['\t'] = CC_SPACE;
+    table.char_class['\n'] = CC_NEWLINE;
+    table.char_class[0xff] = CC_EOF;
+
+    const char punctuation[] = { '~', '?', ':', ';', '[', ']', '(', ')', '{', '}', ',' };
+    const word_type punctuation_type[] = { BITWISE_NEGATION, QUESTION_MARK, COLON, SEMICOLON, LEFT_SQUARE_BRACKET, RIGHT_SQUARE_BRACKET,
+        LEFT_PARENTHESE, RIGHT_PARENTHESE, LEFT_BRACE, RIGHT_BRACE, COMMA };
+    for (int i = 0; i < (int)sizeof(punctuation); i++)
+    {
+        table.char_class[(unsigned char)punctuation[i]] = CC_PUNCTUATION;
+        table.punctuation[(unsigned char)punctuation[i]] = punctuation_type[i];
+    }
+
+    table.push_base[DFA_DECIMAL] = 10;
+    table.push_base[DFA_ZERO] = 8;
+    table.push_base[DFA_OCTAL] = 8;
+    table.push_base[DFA_HEX] = 16;
+
+    //状态0，非法字符报错，不回退
+    dfa_set_all(table, DFA_START, dfa_emit_word(EMIT_ERROR, KEYWORD));
+    dfa_set_letters(table, DFA_START, dfa_go(DFA_ID, DFA_APPEND));
+    table.entry[DFA_START][CC_UNDERSCORE] = dfa_go(DFA_ID, DFA_APPEND);
+    table.entry[DFA_START][CC_OCT_DIGIT] = dfa_go(DFA_DECIMAL, DFA_APPEND);
+    table.entry[DFA_START][CC_DEC_DIGIT] = dfa_go(DFA_DECIMAL, DFA_APPEND);
+    table.entry[DFA_START][CC_ZERO] = dfa_go(DFA_ZERO, DFA_APPEND);
+    table.entry[DFA_START][CC_QUOTE] = dfa_go(DFA_CHAR, DFA_APPEND);
+    table.entry[DFA_START][CC_DOUBLE_QUOTE] = dfa_go(DFA_STRING, DFA_APPEND);
+    table.entry[DFA_START][CC_LESS] = dfa_go(DFA_LESS);
+    table.entry[DFA_START][CC_GREATER] = dfa_go(DFA_GREATER);
+    table.entry[DFA_START][CC_EQUAL] = dfa_go(DFA_EQUAL);
+    table.entry[DFA_START][CC_EXCLAMATION] = dfa_go(DFA_EXCLAMATION);
+    table.entry[DFA_START][CC_PLUS] = dfa_go(DFA_PLUS);
+    table.entry[DFA_START][CC_MINUS] = dfa_go(DFA_MINUS);
+    table.entry[DFA_START][CC_STAR] = dfa_go(DFA_STAR);
+    table.entry[DFA_START][CC_SLASH] = dfa_go(DFA_SLASH);
+    table.entry[DFA_START][CC_PERCENT] = dfa_go(DFA_PERCENT);
+    table.entry[DFA_START][CC_AMPERSAND] = dfa_go(DFA_AMPERSAND);
+    table.entry[DFA_START][CC_BAR] = dfa_go(DFA_BAR);
+    table.entry[DFA_START][CC_CARET] = dfa_go(DFA_CARET);
+    table.entry[DFA_START][CC_DOT] = dfa_go(DFA_DOT, DFA_APPEND);
+    table.entry[DFA_START][CC_PUNCTUATION] = dfa_emit_word(EMIT_PUNCTUATION, KEYWORD);
+    table.entry[DFA_START][CC_SPACE] = dfa_go(DFA_START);
+    table.entry[DFA_START][CC_NEWLINE] = dfa_go(DFA_START, DFA_NEWLINE);
+    table.entry[DFA_START][CC_EOF] = dfa_emit_word(EMIT_END, KEYWORD);
+
+    //标志符
+    dfa_set_all(table, DFA_ID, dfa_emit_word(EMIT_LEXEME, ID, DFA_RETRACT));
+    dfa_set_letters(table, DFA_ID, dfa_go(DFA_ID, DFA_APPEND));
+    dfa_set_digits(table, DFA_ID, dfa_go(DFA_ID, DFA_APPEND));
+    table.entry[DFA_ID][CC_UNDERSCORE] = dfa_go(DFA_ID, DFA_APPEND);
+    table.entry[DFA_ID][CC_DOLLAR] = dfa_go(DFA_ID, DFA_APPEND);
+
+    //十进制整数
+    dfa_set_all(table, DFA_DECIMAL, dfa_emit_word(EMIT_NUMBER, INT, DFA_RETRACT));
+    dfa_set_digits(table, DFA_DECIMAL, dfa_go(DFA_DECIMAL, DFA_APPEND));
+    table.entry[DFA_DECIMAL][CC_DOT] = dfa_go(DFA_FRACTION, DFA_APPEND);
+    table.entry[DFA_DECIMAL][CC_E] = dfa_go(DFA_EXPONENT, DFA_APPEND);
+    dfa_set_suffix(table, DFA_DECIMAL);
+
+    //0开头
+    dfa_set_all(table, DFA_ZERO, dfa_emit_word(EMIT_NUMBER, INT, DFA_RETRACT));
+    table.entry[DFA_ZERO][CC_ZERO] = dfa_go(DFA_OCTAL, DFA_APPEND);
+    table.entry[DFA_ZERO][CC_OCT_DIGIT] = dfa_go(DFA_OCTAL, DFA_APPEND);
+    table.entry[DFA_ZERO][CC_X] = dfa_go(DFA_HEX_PREFIX, DFA_APPEND);
+    table.entry[DFA_ZERO][CC_DEC_DIGIT] = dfa_go(DFA_BAD_OCTAL, DFA_APPEND);
+    table.entry[DFA_ZERO][CC_DOT] = dfa_go(DFA_FRACTION, DFA_APPEND);
+    table.entry[DFA_ZERO][CC_E] = dfa_go(DFA_EXPONENT, DFA_APPEND);
+    dfa_set_suffix(table, DFA_ZERO);
+
+    //八进制数
+    dfa_set_all(table, DFA_OCTAL, dfa_emit_word(EMIT_NUMBER, INT, DFA_RETRACT));
+    table.entry[DFA_OCTAL][CC_ZERO] = dfa_go(DFA_OCTAL, DFA_APPEND);
+    table.entry[DFA_OCTAL][CC_OCT_DIGIT] = dfa_go(DFA_OCTAL, DFA_APPEND);
+    table.entry[DFA_OCTAL][CC_DEC_DIGIT] = dfa_go(DFA_BAD_OCTAL, DFA_APPEND);
+    table.entry[DFA_OCTAL][CC_DOT] = dfa_go(DFA_FRACTION, DFA_APPEND);
+    table.entry[DFA_OCTAL][CC_E] = dfa_go(DFA_EXPONENT, DFA_APPEND);
+    dfa_set_suffix(table, DFA_OCTAL);
+
+    //十六进制数，0x后至少要有一位数字
+    const int hex_digits[] = { CC_ZERO, CC_OCT_DIGIT, CC_DEC_DIGIT, CC_HEX_LETTER, CC_E, CC_F };
+    dfa_set_all(table, DFA_HEX_PREFIX, dfa_error());
+    dfa_set_all(table, DFA_HEX, dfa_emit_word(EMIT_NUMBER, INT, DFA_RETRACT));
+    for (int cc : hex_digits)
+    {
+        table.entry[DFA_HEX_PREFIX][cc] = dfa_go(DFA_HEX, DFA_APPEND);
+        table.entry[DFA_HEX][cc] = dfa_go(DFA_HEX, DFA_APPEND);
+    }
+    dfa_set_suffix(table, DFA_HEX);
+
+    //0开头且含8、9，只能是实型
+    dfa_set_all(table, DFA_BAD_OCTAL, dfa_error());
+    table.entry[DFA_BAD_OCTAL][CC_DEC_DIGIT] = dfa_go(DFA_BAD_OCTAL, DFA_APPEND);
+    table.entry[DFA_BAD_OCTAL][CC_DOT] = dfa_go(DFA_FRACTION, DFA_APPEND);
+    table.entry[DFA_BAD_OCTAL][CC_E] = dfa_go(DFA_EXPONENT, DFA_APPEND);
+
+    //小数
+    dfa_set_all(table, DFA_FRACTION, dfa_emit_word(EMIT_LEXEME, FLOAT, DFA_RETRACT));
+    dfa_set_digits(table, DFA_FRACTION, dfa_go(DFA_FRACTION, DFA_APPEND));
+    table.entry[DFA_FRACTION][CC_E] = dfa_go(DFA_EXPONENT, DFA_APPEND);
+    table.entry[DFA_FRACTION][CC_F] = dfa_emit_word(EMIT_LEXEME, FLOAT);
+    table.entry[DFA_FRACTION][CC_L] = dfa_emit_word(EMIT_LEXEME, DOUBLE);
+
+    //指数
+    dfa_set_all(table, DFA_EXPONENT, dfa_error());
+    dfa_set_digits(table, DFA_EXPONENT, dfa_go(DFA_EXPONENT_DIGIT, DFA_APPEND));
+    table.entry[DFA_EXPONENT][CC_PLUS] = dfa_go(DFA_EXPONENT_SIGN, DFA_APPEND);
+    table.entry[DFA_EXPONENT][CC_MINUS] = dfa_go(DFA_EXPONENT_SIGN, DFA_APPEND);
+
+    dfa_set_all(table, DFA_EXPONENT_SIGN, dfa_error());
+    dfa_set_digits(table, DFA_EXPONENT_SIGN, dfa_go(DFA_EXPONENT_DIGIT, DFA_APPEND));
+
+    dfa_set_all(table, DFA_EXPONENT_DIGIT, dfa_emit_word(EMIT_LEXEME, FLOAT, DFA_RETRACT));
+    dfa_set_digits(table, DFA_EXPONENT_DIGIT, dfa_go(DFA_EXPONENT_DIGIT, DFA_APPEND));
+    table.entry[DFA_EXPONENT_DIGIT][CC_F] = dfa_emit_word(EMIT_LEXEME, FLOAT);
+    table.entry[DFA_EXPONENT_DIGIT][CC_L] = dfa_emit_word(EMIT_LEXEME, DOUBLE);
+
+    //整型常量后缀
+    dfa_set_all(table, DFA_U_SUFFIX, dfa_emit_word(EMIT_NUMBER, UINT, DFA_RETRACT));
+    table.entry[DFA_U_SUFFIX][CC_L] = dfa_emit_word(EMIT_NUMBER, ULONG);
+    dfa_set_all(table, DFA_L_SUFFIX, dfa_emit_word(EMIT_NUMBER, LONG, DFA_RETRACT));
+    table.entry[DFA_L_SUFFIX][CC_U] = dfa_emit_word(EMIT_NUMBER, ULONG);
+
+    //字符常量、字符串常量
+    dfa_set_quoted(table, DFA_CHAR, DFA_CHAR_ESCAPE, CC_QUOTE, CHAR);
+    dfa_set_quoted(table, DFA_STRING, DFA_STRING_ESCAPE, CC_DOUBLE_QUOTE, STRING);
+
+    //'<'、'<<'
+    dfa_set_all(table, DFA_LESS, dfa_operator(RELATION_OPERATOR, LESS, DFA_RETRACT));
+    table.entry[DFA_LESS][CC_EQUAL] = dfa_operator(RELATION_OPERATOR, LESS_EQUAL);
+    table.entry[DFA_LESS][CC_LESS] = dfa_go(DFA_LSHIFT);
+    dfa_set_all(table, DFA_LSHIFT, dfa_emit_word(EMIT_WORD, BITWISE_LSHIFT, DFA_RETRACT));
+    table.entry[DFA_LSHIFT][CC_EQUAL] = dfa_operator(ASSIGN_OPERATOR, LSHIFT_EQUAL);
+
+    //'>'、'>>'
+    dfa_set_all(table, DFA_GREATER, dfa_operator(RELATION_OPERATOR, GREATER, DFA_RETRACT));
+    table.entry[DFA_GREATER][CC_EQUAL] = dfa_operator(RELATION_OPERATOR, GREATER_EQUAL);
+    table.entry[DFA_GREATER][CC_GREATER] = dfa_go(DFA_RSHIFT);
+    dfa_set_all(table, DFA_RSHIFT, dfa_emit_word(EMIT_WORD, BITWISE_RSHIFT, DFA_RETRACT));
+    table.entry[DFA_RSHIFT][CC_EQUAL] = dfa_operator(ASSIGN_OPERATOR, RSHIFT_EQUAL);
+
+    //'='
+    dfa_set_all(table, DFA_EQUAL, dfa_operator(ASSIGN_OPERATOR, SIMPLE_EQUAL, DFA_RETRACT));
+    table.entry[DFA_EQUAL][CC_EQUAL] = dfa_operator(RELATION_OPERATOR, EQUAL);
+
+    //'!'
+    dfa_set_all(table, DFA_EXCLAMATION, dfa_emit_word(EMIT_WORD, LOGICAL_NEGATION, DFA_RETRACT));
+    table.entry[DFA_EXCLAMATION][CC_EQUAL] = dfa_operator(RELATION_OPERATOR, UNEQUAL);
+
+    //'+'
+    dfa_set_all(table, DFA_PLUS, dfa_emit_word(EMIT_WORD, PLUS, DFA_RETRACT));
+    table.entry[DFA_PLUS][CC_EQUAL] = dfa_operator(ASSIGN_OPERATOR, PLUS_EQUAL);
+    table.entry[DFA_PLUS][CC_PLUS] = dfa_emit_word(EMIT_WORD, INC);
+
+    //'-'
+    dfa_set_all(table, DFA_MINUS, dfa_emit_word(EMIT_WORD, MINUS, DFA_RETRACT));
+    table.entry[DFA_MINUS][CC_EQUAL] = dfa_operator(ASSIGN_OPERATOR, MINUS_EQUAL);
+    table.entry[DFA_MINUS][CC_MINUS] = dfa_emit_word(EMIT_WORD, DEC);
+    table.entry[DFA_MINUS][CC_GREATER] = dfa_emit_word(EMIT_WORD, ARROW);
+
+    //'*'
+    dfa_set_all(table, DFA_STAR, dfa_emit_word(EMIT_WORD, MULTIPLY, DFA_RETRACT));
+    table.entry[DFA_STAR][CC_EQUAL] = dfa_operator(ASSIGN_OPERATOR, MULTIPLY_EQUAL);
+
+    //'/'、注释
+    dfa_set_all(table, DFA_SLASH, dfa_emit_word(EMIT_WORD, DIVIDE, DFA_RETRACT));
+    table.entry[DFA_SLASH][CC_EQUAL] = dfa_operator(ASSIGN_OPERATOR, DIVIDE_EQUAL);
+    table.entry[DFA_SLASH][CC_SLASH] = dfa_go(DFA_LINE_COMMENT);
+    table.entry[DFA_SLASH][CC_STAR] = dfa_go(DFA_BLOCK_COMMENT);
+
+    dfa_set_all(table, DFA_LINE_COMMENT, dfa_go(DFA_LINE_COMMENT));
+    table.entry[DFA_LINE_COMMENT][CC_NEWLINE] = dfa_go(DFA_START, DFA_RETRACT);
+    table.entry[DFA_LINE_COMMENT][CC_EOF] = dfa_go(DFA_START, DFA_RETRACT);
+
+    dfa_set_all(table, DFA_BLOCK_COMMENT, dfa_go(DFA_BLOCK_COMMENT));
+    table.entry[DFA_BLOCK_COMMENT][CC_EOF] = dfa_error();
+    table.entry[DFA_BLOCK_COMMENT][CC_NEWLINE] = dfa_go(DFA_BLOCK_COMMENT, DFA_NEWLINE);
+    table.entry[DFA_BLOCK_COMMENT][CC_STAR] = dfa_go(DFA_BLOCK_COMMENT_STAR);
+
+    dfa_set_all(table, DFA_BLOCK_COMMENT_STAR, dfa_go(DFA_BLOCK_COMMENT));
+    table.entry[DFA_BLOCK_COMMENT_STAR][CC_EOF] = dfa_error();
+    table.entry[DFA_BLOCK_COMMENT_STAR][CC_NEWLINE] = dfa_go(DFA_BLOCK_COMMENT_STAR, DFA_NEWLINE);
+    table.entry[DFA_BLOCK_COMMENT_STAR][CC_SLASH] = dfa_go(DFA_START);
+    table.entry[DFA_BLOCK_COMMENT_STAR][CC_STAR] = dfa_go(DFA_BLOCK_COMMENT_STAR);
+
+    //'%'
+    dfa_set_all(table, DFA_PERCENT, dfa_emit_word(EMIT_WORD, MOD, DFA_RETRACT));
+    table.entry[DFA_PERCENT][CC_EQUAL] = dfa_operator(ASSIGN_OPERATOR, MOD_EQUAL);
+
+    //'&'
+    dfa_set_all(table, DFA_AMPERSAND, dfa_emit_word(EMIT_WORD, BITWISE_AND, DFA_RETRACT));
+    table.entry[DFA_AMPERSAND][CC_EQUAL] = dfa_operator(ASSIGN_OPERATOR, AND_EQUAL);
+    table.entry[DFA_AMPERSAND][CC_AMPERSAND] = dfa_emit_word(EMIT_WORD, LOGICAL_AND);
+
+    //'|'
+    dfa_set_all(table, DFA_BAR, dfa_emit_word(EMIT_WORD, BITWISE_OR, DFA_RETRACT));
+    table.entry[DFA_BAR][CC_EQUAL] = dfa_operator(ASSIGN_OPERATOR, OR_EQUAL);
+    table.entry[DFA_BAR][CC_BAR] = dfa_emit_word(EMIT_WORD, LOGICAL_OR);
+
+    //'^'
+    dfa_set_all(table, DFA_CARET, dfa_emit_word(EMIT_WORD, BITWISE_XOR, DFA_RETRACT));
+    table.entry[DFA_CARET][CC_EQUAL] = dfa_operator(ASSIGN_OPERATOR, XOR_EQUAL);
+
+    //'.'，后接数字时为小数
+    dfa_set_all(table, DFA_DOT, dfa_emit_word(EMIT_WORD, DOT, DFA_RETRACT));
+    dfa_set_digits(table, DFA_DOT, dfa_go(DFA_FRACTION, DFA_APPEND));
+
+    for (int state = 0; state < DFA_STATE_AMOUNT; state++)
+    {
+        for (int cc = 0; cc < CHAR_CLASS_AMOUNT; cc++)
+        {
+            dfa_entry& entry = table.entry[state][cc];
+            if (entry.emit == EMIT_NONE && (entry.action & ~DFA_APPEND) == 0 && table.push_base[entry.next] == 0)
+                entry.action |= DFA_SIMPLE;
+        }
+    }
+    return table;
+}
+
+constexpr dfa_table DFA_TABLE = make_dfa_table();
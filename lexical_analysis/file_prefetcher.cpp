@@ -0,0 +1,485 @@
+﻿#include "file_prefetcher.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+using namespace std;
+
+const string_view PREFETCH_MODE_NAMES[PREFETCH_MODE_AMOUNT] = { "off", "threads", "uring" };
+
+string_view prefetch_mode_name(prefetch_mode mode)
+{
+    return PREFETCH_MODE_NAMES[mode];
+}
+
+bool parse_prefetch_mode(string_view name, prefetch_mode& mode)
+{
+    for (int i = 0; i < PREFETCH_MODE_AMOUNT; i++)
+    {
+        if (PREFETCH_MODE_NAMES[i] == name)
+        {
+            mode = (prefetch_mode)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+#ifdef HAVE_IO_URING
+/**
+ * io_uring的提交队列和完成队列，直接使用系统调用，不依赖liburing
+ * 只由一个线程使用：提交队列的队尾和完成队列的队头由本线程推进，与内核之间用acquire/release同步
+ */
+class io_ring
+{
+public:
+    io_ring() = default;
+    io_ring(const io_ring&) = delete;
+    io_ring& operator=(const io_ring&) = delete;
+    ~io_ring();
+
+    //建立至少entries项的队列，并确认内核支持IORING_OP_READ
+    bool setup(unsigned entries);
+
+    //取得一个空的提交项，提交队列已满时返回nullptr
+    io_uring_sqe* get_sqe();
+
+    //提交已填写的提交项，并等待至少wait_nr个完成项
+    int submit(unsigned wait_nr);
+
+    //取出一个完成项，没有时返回false
+    bool pop(io_uring_cqe& cqe);
+
+    //撤回尚未交给内核的提交项，按填写顺序取出其user_data；之后不能再调用submit
+    void cancel_unsubmitted(vector<uint64_t>& user_data);
+
+private:
+    int fd = -1;
+    void* sq_ring = MAP_FAILED;
+    size_t sq_ring_size = 0;
+    void* cq_ring = MAP_FAILED;
+    size_t cq_ring_size = 0;
+    io_uring_sqe* sqes = (io_uring_sqe*)MAP_FAILED;
+    size_t sqes_size = 0;
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned sq_mask = 0;
+    unsigned sq_entries = 0;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+    unsigned sqe_tail = 0;          //已填写的提交项
+    unsigned sqe_submitted = 0;     //已交给内核的提交项
+};
+
+io_ring::~io_ring()
+{
+    if (sqes != MAP_FAILED)
+        munmap(sqes, sqes_size);
+    if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+        munmap(cq_ring, cq_ring_size);
+    if (sq_ring != MAP_FAILED)
+        munmap(sq_ring, sq_ring_size);
+    if (fd >= 0)
+        close(fd);
+}
+
+bool io_ring::setup(unsigned entries)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0)
+        return false;
+
+    //IORING_OP_READ需要5.6以上的内核，用探测结果确认
+    vector<char> probe_storage(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+    io_uring_probe* probe = (io_uring_probe*)probe_storage.data();
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) < 0 || probe->last_op < IORING_OP_READ
+        || !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED))
+        return false;
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_map = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_map)
+        sq_ring_size = cq_ring_size = max(sq_ring_size, cq_ring_size);
+    sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED)
+        return false;
+    cq_ring = single_map ? sq_ring : mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (cq_ring == MAP_FAILED)
+        return false;
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = (io_uring_sqe*)mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+        return false;
+
+    char* sq = (char*)sq_ring;
+    sq_head = (unsigned*)(sq + params.sq_off.head);
+    sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    sq_array = (unsigned*)(sq + params.sq_off.array);
+    sq_mask = *(unsigned*)(sq + params.sq_off.ring_mask);
+    sq_entries = *(unsigned*)(sq + params.sq_off.ring_entries);
+    char* cq = (char*)cq_ring;
+    cq_head = (unsigned*)(cq + params.cq_off.head);
+    cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    cq_mask = *(unsigned*)(cq + params.cq_off.ring_mask);
+    cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+    sqe_tail = *sq_tail;
+    sqe_submitted = sqe_tail;
+    return true;
+}
+
+io_uring_sqe* io_ring::get_sqe()
+{
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if (sqe_tail - head >= sq_entries)
+        return nullptr;
+    unsigned index = sqe_tail & sq_mask;
+    io_uring_sqe* sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array[index] = index;
+    sqe_tail++;
+    return sqe;
+}
+
+int io_ring::submit(unsigned wait_nr)
+{
+    __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+    while (true)
+    {
+        int ret = (int)syscall(__NR_io_uring_enter, fd, sqe_tail - sqe_submitted, wait_nr, wait_nr ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret > 0)
+            sqe_submitted += ret;
+        return ret;
+    }
+}
+
+bool io_ring::pop(io_uring_cqe& cqe)
+{
+    unsigned head = *cq_head;
+    if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+        return false;
+    cqe = cqes[head & cq_mask];
+    __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+//没有SQPOLL时内核只在io_uring_enter中读取提交队列，撤回队尾是安全的
+void io_ring::cancel_unsubmitted(vector<uint64_t>& user_data)
+{
+    for (unsigned i = sqe_submitted; i != sqe_tail; i++)
+        user_data.push_back(sqes[i & sq_mask].user_data);
+    sqe_tail = sqe_submitted;
+    __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+}
+#else
+class io_ring
+{
+public:
+    bool setup(unsigned entries) { return false; }
+};
+#endif
+
+//打开源程序并按文件大小准备缓冲区，打开失败时返回false
+static bool open_file(const string& path, file_buffer& buffer)
+{
+    buffer.opened = false;
+    buffer.size = 0;
+    buffer.expected = 0;
+#ifdef _WIN32
+    //与open_source相同以文本方式读入，读到的字节数可能少于文件大小
+    buffer.fd = _open(path.c_str(), _O_RDONLY | _O_TEXT);
+    struct _stat64 st;
+    if (buffer.fd < 0 || _fstat64(buffer.fd, &st) != 0)
+#else
+    buffer.fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (buffer.fd < 0 || fstat(buffer.fd, &st) != 0)
+#endif
+    {
+        if (buffer.fd >= 0)
+            close(buffer.fd);
+        buffer.fd = -1;
+        return false;
+    }
+    buffer.expected = st.st_size;
+    if (buffer.data.size() < buffer.expected)
+        buffer.data.resize(buffer.expected);
+    return true;
+}
+
+//关闭读完的文件，读到文件大小或提前读到文件结束都视为成功
+static void finish_file(file_buffer& buffer, bool success)
+{
+    close(buffer.fd);
+    buffer.fd = -1;
+    buffer.opened = success;
+}
+
+//同步读入整个文件
+static void read_file(const string& path, file_buffer& buffer)
+{
+    if (!open_file(path, buffer))
+        return;
+    while (buffer.size < buffer.expected)
+    {
+#ifdef _WIN32
+        int count = _read(buffer.fd, buffer.data.data() + buffer.size, (unsigned)min(buffer.expected - buffer.size, (size_t)1 << 30));
+#else
+        ssize_t count = read(buffer.fd, buffer.data.data() + buffer.size, buffer.expected - buffer.size);
+#endif
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+        {
+            finish_file(buffer, count == 0);
+            return;
+        }
+        buffer.size += count;
+    }
+    finish_file(buffer, true);
+}
+
+#ifdef HAVE_IO_URING
+//从buffer.size处同步读入文件的剩余部分，用于io_uring无法继续提交时
+static void read_rest(file_buffer& buffer)
+{
+    while (buffer.size < buffer.expected)
+    {
+        ssize_t count = pread(buffer.fd, buffer.data.data() + buffer.size, buffer.expected - buffer.size, buffer.size);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+        {
+            finish_file(buffer, count == 0);
+            return;
+        }
+        buffer.size += count;
+    }
+    finish_file(buffer, true);
+}
+#endif
+
+file_prefetcher::file_prefetcher(const vector<string>& files, prefetch_mode requested, int buffer_num, int reader_num)
+    : files(files), mode(requested), ready(max(buffer_num, 1)), free_buffers(max(buffer_num, 1))
+{
+    buffer_num = max(buffer_num, 1);
+    for (int i = 0; i < buffer_num; i++)
+    {
+        buffers.push_back(make_unique<file_buffer>());
+        free_buffers.try_push(buffers.back().get());
+    }
+    if (mode == PREFETCH_URING)
+    {
+        ring = make_unique<io_ring>();
+        if (!ring->setup(buffer_num))
+        {
+            ring.reset();
+            mode = PREFETCH_THREADS;
+        }
+    }
+    if (mode == PREFETCH_URING)
+        readers.emplace_back(&file_prefetcher::read_with_uring, this);
+    else
+    {
+        for (int i = 0; i < max(reader_num, 1); i++)
+            readers.emplace_back(&file_prefetcher::read_with_threads, this);
+    }
+}
+
+file_prefetcher::~file_prefetcher()
+{
+    stopping = true;
+    free_waiter.notify();
+    for (thread& t : readers)
+        t.join();
+}
+
+file_buffer* file_prefetcher::next()
+{
+    if (taken++ >= files.size())
+        return nullptr;
+    file_buffer* buffer = nullptr;
+    ready_waiter.wait([&] { return ready.try_pop(buffer); });
+    return buffer;
+}
+
+void file_prefetcher::recycle(file_buffer* buffer)
+{
+    free_buffers.try_push(buffer);
+    free_waiter.notify();
+}
+
+//取出空闲缓冲区，没有时等待；停止时返回nullptr
+file_buffer* file_prefetcher::take_free()
+{
+    file_buffer* buffer = nullptr;
+    free_waiter.wait([&] { return free_buffers.try_pop(buffer) || stopping; });
+    return buffer;
+}
+
+//就绪队列的容量与缓冲区数相同，放入总能成功
+void file_prefetcher::publish(file_buffer* buffer)
+{
+    ready.try_push(buffer);
+    ready_waiter.notify();
+}
+
+void file_prefetcher::read_with_threads()
+{
+    while (true)
+    {
+        size_t index = next_file++;
+        if (index >= files.size())
+            return;
+        file_buffer* buffer = take_free();
+        if (!buffer)
+            return;
+        buffer->index = index;
+        read_file(files[index], *buffer);
+        publish(buffer);
+    }
+}
+
+void file_prefetcher::read_with_uring()
+{
+#ifdef HAVE_IO_URING
+    //提交从buffer->size开始的剩余部分
+    auto submit_read = [this](file_buffer* buffer) {
+        io_uring_sqe* sqe = ring->get_sqe();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = buffer->fd;
+        sqe->addr = (uint64_t)(buffer->data.data() + buffer->size);
+        sqe->len = (unsigned)min(buffer->expected - buffer->size, (size_t)1 << 30);
+        sqe->off = buffer->size;
+        sqe->user_data = (uint64_t)buffer;
+    };
+
+    size_t next = 0;
+    int in_flight = 0;
+    while (true)
+    {
+        //按顺序打开文件并提交读取；没有空闲缓冲区时，有读取在进行就先处理完成项，否则等待分析线程归还
+        while (next < files.size() && !stopping)
+        {
+            file_buffer* buffer = nullptr;
+            if (!free_buffers.try_pop(buffer))
+            {
+                if (in_flight > 0)
+                    break;
+                buffer = take_free();
+                if (!buffer)
+                    break;
+            }
+            buffer->index = next++;
+            if (!open_file(files[buffer->index], *buffer))
+            {
+                publish(buffer);
+                continue;
+            }
+            if (buffer->expected == 0)
+            {
+                finish_file(*buffer, true);
+                publish(buffer);
+                continue;
+            }
+            submit_read(buffer);
+            in_flight++;
+        }
+        if (in_flight == 0)
+            return;
+
+        //完成队列暂时已满或内核资源不足时先处理完成项再重新提交；其他错误时不再使用io_uring
+        if (ring->submit(1) < 0 && errno != EAGAIN && errno != EBUSY)
+        {
+            abandon_uring(next, in_flight);
+            return;
+        }
+        io_uring_cqe cqe;
+        while (ring->pop(cqe))
+        {
+            file_buffer* buffer = (file_buffer*)cqe.user_data;
+            if (cqe.res == -EAGAIN || cqe.res == -EINTR)
+            {
+                submit_read(buffer);
+                continue;
+            }
+            if (cqe.res > 0)
+            {
+                buffer->size += cqe.res;
+                if (buffer->size < buffer->expected)
+                {
+                    submit_read(buffer);
+                    continue;
+                }
+            }
+            in_flight--;
+            finish_file(*buffer, cqe.res >= 0);
+            publish(buffer);
+        }
+    }
+#endif
+}
+
+/**
+ * io_uring_enter失败后改用同步读取：未提交的读取直接同步读完；已提交的读取仍由内核写入缓冲区，
+ * 等到其完成项后再同步读完剩余部分，之后才能交给分析线程；其余文件由本线程按读取线程的方式读入
+ */
+void file_prefetcher::abandon_uring(size_t next, int in_flight)
+{
+#ifdef HAVE_IO_URING
+    vector<uint64_t> pending;
+    ring->cancel_unsubmitted(pending);
+    for (uint64_t data : pending)
+    {
+        file_buffer* buffer = (file_buffer*)data;
+        read_rest(*buffer);
+        publish(buffer);
+        in_flight--;
+    }
+    while (in_flight > 0)
+    {
+        io_uring_cqe cqe;
+        if (!ring->pop(cqe))
+        {
+            this_thread::sleep_for(chrono::milliseconds(1));
+            continue;
+        }
+        file_buffer* buffer = (file_buffer*)cqe.user_data;
+        in_flight--;
+        if (cqe.res > 0)
+            buffer->size += cqe.res;
+        if (cqe.res >= 0 || cqe.res == -EAGAIN || cqe.res == -EINTR)
+            read_rest(*buffer);
+        else
+            finish_file(*buffer, false);
+        publish(buffer);
+    }
+    next_file = next;
+    read_with_threads();
+#endif
+}
@@ -0,0 +1,133 @@
+﻿#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "bounded_queue.h"
+
+class io_ring;
+
+//批量分析读取源程序的方式
+enum prefetch_mode
+{
+    PREFETCH_OFF,           //各工作线程分析前自己打开源程序
+    PREFETCH_THREADS,       //读取线程预读
+    PREFETCH_URING,         //用io_uring预读，不可用时改用读取线程
+    PREFETCH_MODE_AMOUNT
+};
+
+std::string_view prefetch_mode_name(prefetch_mode mode);
+
+//按名称（off、threads、uring）解析读取方式，名称无效时返回false
+bool parse_prefetch_mode(std::string_view name, prefetch_mode& mode);
+
+//预读的源程序，缓冲区在文件之间重复使用，只在文件更大时扩大
+struct file_buffer
+{
+    size_t index = 0;           //在文件列表中的下标
+    bool opened = false;        //是否成功打开并读完
+    std::vector<char> data;     //容量，不小于size
+    size_t size = 0;            //已读入的字节数
+    size_t expected = 0;        //文件大小，读取中使用
+    int fd = -1;                //读取中的文件
+};
+
+//消费者在无锁队列为空（或生产者在空闲缓冲区用完）时的等待点，只在慢路径上使用互斥量
+class queue_waiter
+{
+public:
+    //等待到try_take成功，try_take在持有锁时再检查一次，避免丢失通知
+    template <class Take>
+    void wait(Take try_take)
+    {
+        for (int i = 0; i < SPIN_COUNT; i++)
+        {
+            if (try_take())
+                return;
+            std::this_thread::yield();
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        sleepers++;
+        //与notify中的栅栏配对：登记等待之后才检查队列，放入者在放入之后才检查等待者，两者至少有一方看到对方
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (!try_take())
+            wakeup.wait(lock);
+        sleepers--;
+    }
+
+    //放入元素后调用，没有等待者时只有一次原子读
+    void notify()
+    {
+        //放入队列的release写入不能与之后对sleepers的读取重排，否则可能读到0而等待者又没看到新元素
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load() == 0)
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        wakeup.notify_all();
+    }
+
+private:
+    static constexpr int SPIN_COUNT = 64;
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::atomic<int> sleepers{ 0 };
+};
+
+/**
+ * 源程序预读
+ * 读取线程（或io_uring）从空闲缓冲区队列取出缓冲区，按文件列表的顺序读入源程序后放入就绪队列，
+ * 分析线程从就绪队列取出文件，分析完后把缓冲区归还到空闲队列；两个队列都是有界无锁队列，
+ * 缓冲区总数限制了预读的文件数和内存，读取与分析重叠进行
+ * io_uring方式由一个线程提交读取：打开文件和取得大小仍是同步调用，读取内容异步进行，最多有缓冲区数个读取同时进行
+ */
+class file_prefetcher
+{
+public:
+    /**
+     * 开始预读
+     * const std::vector<std::string>& files - 源程序路径，需在预读器使用期间保持有效
+     * prefetch_mode requested - PREFETCH_THREADS或PREFETCH_URING
+     * int buffer_num - 缓冲区数
+     * int reader_num - 读取线程数，只用于PREFETCH_THREADS
+     */
+    file_prefetcher(const std::vector<std::string>& files, prefetch_mode requested, int buffer_num = 64, int reader_num = 4);
+    ~file_prefetcher();
+
+    file_prefetcher(const file_prefetcher&) = delete;
+    file_prefetcher& operator=(const file_prefetcher&) = delete;
+
+    //实际使用的读取方式，io_uring不可用时为PREFETCH_THREADS
+    prefetch_mode get_mode() const { return mode; }
+
+    //取出一个读好的文件，文件的顺序不确定；全部文件都已取出时返回nullptr
+    file_buffer* next();
+
+    //分析完后归还缓冲区
+    void recycle(file_buffer* buffer);
+
+private:
+    void read_with_threads();
+    void read_with_uring();
+    void abandon_uring(size_t next, int in_flight);
+    file_buffer* take_free();
+    void publish(file_buffer* buffer);
+
+    const std::vector<std::string>& files;
+    prefetch_mode mode;
+    std::vector<std::unique_ptr<file_buffer>> buffers;
+    bounded_queue<file_buffer*> ready;
+    bounded_queue<file_buffer*> free_buffers;
+    queue_waiter ready_waiter;
+    queue_waiter free_waiter;
+    std::atomic<size_t> next_file{ 0 };     //读取线程领取的下一个文件
+    std::atomic<size_t> taken{ 0 };         //分析线程已领取的文件数
+    std::atomic<bool> stopping{ false };
+    std::unique_ptr<io_ring> ring;          //PREFETCH_URING时使用
+    std::vector<std::thread> readers;
+};
@@ -0,0 +1,346 @@
+﻿#include "frequency_summary.h"
+#include "keyword.h"
+#include "source_buffer.h"
+#include "token.h"
+#include "varint.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+using namespace std;
+
+static const char SUMMARY_MAGIC[4] = { 'L', 'X', 'F', 'Q' };
+const uint64_t SUMMARY_VERSION = 1;
+
+//按次数从大到小、次数相同时按内容排序
+static bool more_frequent(const frequency_entry& a, const frequency_entry& b)
+{
+    return a.count != b.count ? a.count > b.count : a.text < b.text;
+}
+
+static size_t round_up_power_of_two(size_t n)
+{
+    size_t power = 1;
+    while (power < n)
+        power <<= 1;
+    return power;
+}
+
+frequency_counter::frequency_counter(size_t width, size_t depth, size_t candidate_num)
+    : width(width == 0 ? 0 : round_up_power_of_two(width)), depth(width == 0 ? 0 : max<size_t>(depth, 1)), candidate_num(max<size_t>(candidate_num, 1)),
+    sketch(this->width * this->depth)
+{
+}
+
+/**
+ * 由符号表的32位哈希值用双重哈希得到各行的列：第r行为h1 + r * h2，h2为奇数，在2的幂宽度下各行互不相同
+ * 乘以黄金分割常数把哈希值的各位混合到h1和h2中
+ */
+uint64_t frequency_counter::estimate(uint32_t h) const
+{
+    uint64_t x = h * 0x9e3779b97f4a7c15ull;
+    size_t h1 = (size_t)(x >> 32), h2 = (size_t)(uint32_t)x | 1;
+    uint64_t result = UINT64_MAX;
+    for (size_t r = 0; r < depth; r++)
+        result = min(result, sketch[r * width + ((h1 + r * h2) & (width - 1))]);
+    return result;
+}
+
+void frequency_counter::add(string_view str, uint64_t occurrences)
+{
+    total += occurrences;
+    if (!is_sketch())
+    {
+        size_t entry = names.insert(str, 0);
+        if (entry == counts.size())
+            counts.push_back(0);
+        counts[entry] += occurrences;
+        return;
+    }
+
+    uint32_t h = symbol_table::hash(str);
+    uint64_t x = h * 0x9e3779b97f4a7c15ull;
+    size_t h1 = (size_t)(x >> 32), h2 = (size_t)(uint32_t)x | 1;
+    for (size_t r = 0; r < depth; r++)
+        sketch[r * width + ((h1 + r * h2) & (width - 1))] += occurrences;
+    uint64_t value = estimate(h);
+
+    //候选已满时，估计值不超过上次裁剪后最小候选的符号不再加入
+    int entry = names.find(str);
+    if (entry != -1)
+        counts[entry] = value;
+    else if (names.size() < candidate_num || value > threshold)
+    {
+        names.insert(str, 0);
+        counts.push_back(value);
+        if (names.size() >= 2 * candidate_num)
+            prune();
+    }
+}
+
+//只保留估计值最大的candidate_num个候选；候选数达到两倍时才裁剪，每次裁剪的代价分摊到之后加入的候选上
+void frequency_counter::prune()
+{
+    vector<pair<string, uint64_t>> kept;
+    kept.reserve(names.size());
+    for (size_t i = 0; i < names.size(); i++)
+        kept.emplace_back(string(names[i]), counts[i]);
+    if (kept.size() > candidate_num)
+    {
+        auto order = [](const pair<string, uint64_t>& a, const pair<string, uint64_t>& b) { return a.second != b.second ? a.second > b.second : a.first < b.first; };
+        nth_element(kept.begin(), kept.begin() + (candidate_num - 1), kept.end(), order);
+        kept.resize(candidate_num);
+        threshold = kept.back().second;
+    }
+    names.clear();
+    counts.clear();
+    for (const pair<string, uint64_t>& candidate : kept)
+    {
+        names.insert(candidate.first, 0);
+        counts.push_back(candidate.second);
+    }
+}
+
+bool frequency_counter::can_merge(const frequency_counter& other) const
+{
+    return !other.is_sketch() || (width == other.width && depth == other.depth);
+}
+
+bool frequency_counter::merge(const frequency_counter& other)
+{
+    if (!other.is_sketch())
+    {
+        for (size_t i = 0; i < other.names.size(); i++)
+            add(other.names[i], other.counts[i]);
+        return true;
+    }
+    if (!can_merge(other))
+        return false;
+
+    //计数器逐项相加，候选取并集后按合并后的略图重新估计
+    for (size_t i = 0; i < sketch.size(); i++)
+        sketch[i] += other.sketch[i];
+    total += other.total;
+    for (size_t i = 0; i < other.names.size(); i++)
+    {
+        if ((size_t)names.insert(other.names[i], 0) == counts.size())
+            counts.push_back(0);
+    }
+    for (size_t i = 0; i < names.size(); i++)
+        counts[i] = estimate(symbol_table::hash(names[i]));
+    threshold = 0;
+    if (names.size() >= 2 * candidate_num)
+        prune();
+    return true;
+}
+
+uint64_t frequency_counter::count(string_view str) const
+{
+    if (is_sketch())
+        return estimate(symbol_table::hash(str));
+    int entry = names.find(str);
+    return entry == -1 ? 0 : counts[entry];
+}
+
+vector<frequency_entry> frequency_counter::top(size_t k) const
+{
+    vector<frequency_entry> entries;
+    entries.reserve(names.size());
+    for (size_t i = 0; i < names.size(); i++)
+        entries.push_back({ names[i], counts[i] });
+    k = min(k, entries.size());
+    partial_sort(entries.begin(), entries.begin() + k, entries.end(), more_frequent);
+    entries.resize(k);
+    return entries;
+}
+
+void frequency_counter::encode(string& out) const
+{
+    put_varint(out, width);
+    put_varint(out, depth);
+    put_varint(out, candidate_num);
+    put_varint(out, total);
+    for (uint64_t counter : sketch)
+        put_varint(out, counter);
+    put_varint(out, names.size());
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        string_view entry = names[i];
+        put_varint(out, entry.size());
+        out.append(entry);
+        put_varint(out, counts[i]);
+    }
+}
+
+bool frequency_counter::decode(const char*& pos, const char* end)
+{
+    //每个变长整数至少占1字节，计数器数和表项数不会超过剩余字节数
+    uint64_t new_width, new_depth, new_candidate_num, new_total, entry_num;
+    if (!get_varint(pos, end, new_width) || !get_varint(pos, end, new_depth) || !get_varint(pos, end, new_candidate_num) || !get_varint(pos, end, new_total))
+        return false;
+    if ((new_width & (new_width - 1)) != 0 || (new_width == 0) != (new_depth == 0) || new_candidate_num == 0)
+        return false;
+    if (new_width != 0 && (new_width > (uint64_t)(end - pos) || new_depth > (uint64_t)(end - pos) / new_width))
+        return false;
+    width = new_width;
+    depth = new_depth;
+    candidate_num = new_candidate_num;
+    total = new_total;
+    threshold = 0;
+    sketch.resize(width * depth);
+    for (uint64_t& counter : sketch)
+    {
+        if (!get_varint(pos, end, counter))
+            return false;
+    }
+    names.clear();
+    counts.clear();
+    if (!get_varint(pos, end, entry_num) || entry_num > (uint64_t)(end - pos))
+        return false;
+    for (uint64_t i = 0; i < entry_num; i++)
+    {
+        uint64_t length, count;
+        if (!get_varint(pos, end, length) || length > (uint64_t)(end - pos))
+            return false;
+        string_view entry(pos, length);
+        pos += length;
+        if (!get_varint(pos, end, count) || (size_t)names.insert(entry, 0) != counts.size())
+            return false;
+        counts.push_back(count);
+    }
+    return true;
+}
+
+frequency_summary::frequency_summary(size_t sketch_width, size_t sketch_depth)
+    : ids(sketch_width, sketch_depth), strings(sketch_width, sketch_depth), keyword_num(KEYWORD_AMOUNT), word_type_num(WORD_TYPE_AMOUNT)
+{
+}
+
+void frequency_summary::add(const symbol_table& id_list, const symbol_table& str_list, const vector<int>& word_type_num)
+{
+    file_num++;
+    for (size_t i = 0; i < this->word_type_num.size() && i < word_type_num.size(); i++)
+        this->word_type_num[i] += word_type_num[i];
+
+    //符号表中已有各项的出现次数，次数为0的表项（增量分析中已被删除的记号）不计入
+    for (size_t i = 0; i < id_list.size(); i++)
+    {
+        if (id_list.count(i) != 0)
+            ids.add(id_list[i], id_list.count(i));
+    }
+    for (size_t i = 0; i < str_list.size(); i++)
+    {
+        if (str_list.count(i) != 0)
+            strings.add(str_list[i], str_list.count(i));
+    }
+    for (int i = 0; i < KEYWORD_AMOUNT; i++)
+        keyword_num[i] += id_list.keyword_count(i);
+}
+
+bool frequency_summary::merge(const frequency_summary& other)
+{
+    if (!ids.can_merge(other.ids) || !strings.can_merge(other.strings))
+        return false;
+    file_num += other.file_num;
+    for (int i = 0; i < KEYWORD_AMOUNT; i++)
+        keyword_num[i] += other.keyword_num[i];
+    for (int i = 0; i < WORD_TYPE_AMOUNT; i++)
+        word_type_num[i] += other.word_type_num[i];
+    ids.merge(other.ids);
+    strings.merge(other.strings);
+    return true;
+}
+
+/**
+ * 二进制汇总格式：
+ * 4字节"LXFQ"、版本、文件数，单词类型数及各类单词个数，关键字数及各关键字个数，之后依次为标志符和字符串的统计：
+ * 略图宽度（0表示精确统计）、行数、候选数、出现次数之和、depth * width个计数器、表项数及各表项的长度、内容和次数
+ */
+void frequency_summary::encode(string& out) const
+{
+    out.append(SUMMARY_MAGIC, sizeof(SUMMARY_MAGIC));
+    put_varint(out, SUMMARY_VERSION);
+    put_varint(out, file_num);
+    put_varint(out, WORD_TYPE_AMOUNT);
+    for (uint64_t num : word_type_num)
+        put_varint(out, num);
+    put_varint(out, KEYWORD_AMOUNT);
+    for (uint64_t num : keyword_num)
+        put_varint(out, num);
+    ids.encode(out);
+    strings.encode(out);
+}
+
+bool frequency_summary::decode(const char* data, size_t size)
+{
+    const char* pos = data;
+    const char* end = data + size;
+    uint64_t version, amount;
+    if (size < sizeof(SUMMARY_MAGIC) || memcmp(pos, SUMMARY_MAGIC, sizeof(SUMMARY_MAGIC)) != 0)
+        return false;
+    pos += sizeof(SUMMARY_MAGIC);
+    if (!get_varint(pos, end, version) || version != SUMMARY_VERSION || !get_varint(pos, end, file_num))
+        return false;
+    if (!get_varint(pos, end, amount) || amount != WORD_TYPE_AMOUNT)
+        return false;
+    for (uint64_t& num : word_type_num)
+    {
+        if (!get_varint(pos, end, num))
+            return false;
+    }
+    if (!get_varint(pos, end, amount) || amount != KEYWORD_AMOUNT)
+        return false;
+    for (uint64_t& num : keyword_num)
+    {
+        if (!get_varint(pos, end, num))
+            return false;
+    }
+    return ids.decode(pos, end) && strings.decode(pos, end) && pos == end;
+}
+
+bool frequency_summary::write(const string& path) const
+{
+    string out;
+    encode(out);
+    ofstream file(path, ios::out | ios::binary | ios::trunc);
+    if (!file)
+        return false;
+    file.write(out.data(), out.size());
+    return (bool)file.flush();
+}
+
+bool frequency_summary::read(const string& path)
+{
+    source_buffer file;
+    return open_source(file, path) && decode(file.data, file.size);
+}
+
+static void print_top(ostream& out, const char* title, const frequency_counter& counter, size_t top_k)
+{
+    out << endl << title << " (occurrences: " << counter.get_total();
+    if (counter.is_sketch())
+        out << ", approximate, " << counter.get_depth() << "x" << counter.get_width() << " sketch, " << counter.distinct() << " candidates";
+    else
+        out << ", distinct: " << counter.distinct();
+    out << "):" << endl;
+    for (const frequency_entry& entry : counter.top(top_k))
+        out << setiosflags(ios::left) << setw(14) << entry.count << entry.text << endl;
+}
+
+void print_frequency_report(ostream& out, const frequency_summary& summary, size_t top_k)
+{
+    out << endl << "frequency summary of " << summary.get_file_num() << " files" << endl;
+
+    out << endl << "keyword num:" << endl;
+    vector<int> order(KEYWORD_AMOUNT);
+    for (int i = 0; i < KEYWORD_AMOUNT; i++)
+        order[i] = i;
+    const vector<uint64_t>& keyword_num = summary.get_keyword_num();
+    stable_sort(order.begin(), order.end(), [&](int a, int b) { return keyword_num[a] > keyword_num[b]; });
+    for (int i : order)
+        out << setiosflags(ios::left) << setw(14) << KEYWORD_NAMES[i] << keyword_num[i] << endl;
+
+    print_top(out, "top identifiers", summary.get_ids(), top_k);
+    print_top(out, "top strings", summary.get_strings(), top_k);
+}
@@ -0,0 +1,115 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "symbol_table.h"
+
+//计数最小略图的默认行数，以及近似统计时保留的高频候选数
+constexpr size_t DEFAULT_SKETCH_DEPTH = 4;
+constexpr size_t DEFAULT_CANDIDATE_NUM = 1024;
+
+//频率统计中的一项，text指向汇总自己的文本区，汇总修改后失效
+struct frequency_entry
+{
+    std::string_view text;
+    uint64_t count;
+};
+
+/**
+ * 一类符号（标志符或字符串）的出现次数
+ * 精确统计时在符号表中保存每个不同的符号及其次数；近似统计时使用计数最小略图（count-min sketch），
+ * 内存与不同符号数无关，每个符号的次数不会被低估，另外保留最多candidate_num个估计次数最大的候选用于求前K个
+ */
+class frequency_counter
+{
+public:
+    //width为0时精确统计，否则width向上取为2的幂
+    explicit frequency_counter(size_t width = 0, size_t depth = DEFAULT_SKETCH_DEPTH, size_t candidate_num = DEFAULT_CANDIDATE_NUM);
+
+    frequency_counter(const frequency_counter&) = delete;
+    frequency_counter& operator=(const frequency_counter&) = delete;
+
+    //str的出现次数加上occurrences
+    void add(std::string_view str, uint64_t occurrences);
+
+    //合并另一个统计；精确统计可以并入近似统计，近似统计只能并入宽度和行数相同的近似统计，否则返回false
+    bool merge(const frequency_counter& other);
+
+    //other能否并入本统计
+    bool can_merge(const frequency_counter& other) const;
+
+    //str的出现次数，近似统计时为估计值
+    uint64_t count(std::string_view str) const;
+
+    //出现次数最多的k项，按次数从大到小、次数相同时按内容排序
+    std::vector<frequency_entry> top(size_t k) const;
+
+    bool is_sketch() const { return width != 0; }
+    size_t get_width() const { return width; }
+    size_t get_depth() const { return depth; }
+
+    uint64_t get_total() const { return total; }             //所有符号的出现次数之和
+    size_t distinct() const { return names.size(); }        //精确统计时为不同符号数，近似统计时为候选数
+
+    void encode(std::string& out) const;
+    bool decode(const char*& pos, const char* end);
+
+private:
+    uint64_t estimate(uint32_t h) const;
+    void prune();
+
+    size_t width;
+    size_t depth;
+    size_t candidate_num;
+    uint64_t total = 0;
+    uint64_t threshold = 0;         //上次裁剪后最小候选的估计值
+    symbol_table names;             //精确统计时为全部符号，近似统计时为候选
+    std::vector<uint64_t> counts;   //names中各项的次数，近似统计时为加入时的估计值
+    std::vector<uint64_t> sketch;   //depth行width列的计数器
+};
+
+/**
+ * 多个源程序的标志符、字符串出现次数以及关键字和各类单词个数的汇总
+ * 标志符、字符串和关键字的次数直接取自每个文件的符号表在词法分析时累计的次数，每个文件只按不同的符号加入一次
+ * 汇总可以合并，并行分析时每个工作线程各自汇总，结束后合并；也可以编码后保存，再由其他进程读回合并
+ */
+class frequency_summary
+{
+public:
+    //sketch_width为0时精确统计，否则标志符和字符串都使用该宽度的计数最小略图
+    explicit frequency_summary(size_t sketch_width = 0, size_t sketch_depth = DEFAULT_SKETCH_DEPTH);
+
+    //加入一个文件的分析结果
+    void add(const symbol_table& id_list, const symbol_table& str_list, const std::vector<int>& word_type_num);
+
+    //合并另一个汇总，标志符或字符串统计无法合并时返回false，此时汇总不变
+    bool merge(const frequency_summary& other);
+
+    const frequency_counter& get_ids() const { return ids; }
+    const frequency_counter& get_strings() const { return strings; }
+    const std::vector<uint64_t>& get_keyword_num() const { return keyword_num; }
+    const std::vector<uint64_t>& get_word_type_num() const { return word_type_num; }
+    uint64_t get_file_num() const { return file_num; }
+
+    //编码为二进制汇总，各数值为LEB128变长整数
+    void encode(std::string& out) const;
+
+    //解码二进制汇总，格式或版本不符、内容不完整时返回false
+    bool decode(const char* data, size_t size);
+
+    bool write(const std::string& path) const;
+    bool read(const std::string& path);
+
+private:
+    frequency_counter ids;
+    frequency_counter strings;
+    std::vector<uint64_t> keyword_num;
+    std::vector<uint64_t> word_type_num;
+    uint64_t file_num = 0;
+};
+
+//输出汇总：文件数、各类单词和关键字的个数，以及出现次数最多的top_k个标志符和字符串
+void print_frequency_report(std::ostream& out, const frequency_summary& summary, size_t top_k);
@@ -0,0 +1,148 @@
+﻿#include "incremental_lexer.h"
+#include "lexer.h"
+#include "line_index.h"
+#include "source_buffer.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+//重新分析时丢弃错误信息的输出，错误只记录在error_log中
+static thread_local ostream discarded_errors(nullptr);
+
+//第一个偏移不小于offset的记号
+static size_t lower_bound_token(const token_buffer& token_stream, size_t offset)
+{
+    size_t low = 0, high = token_stream.size();
+    while (low < high)
+    {
+        size_t mid = (low + high) / 2;
+        if (token_stream.offset(mid) < offset)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+//第一个偏移不小于offset的错误
+static size_t lower_bound_error(const vector<lexical_error>& errors, size_t offset)
+{
+    return partition_point(errors.begin(), errors.end(), [offset](const lexical_error& error) { return error.offset < offset; }) - errors.begin();
+}
+
+//执行analyze，期间的词法错误只记录在errors中，不输出
+template <class Analyze>
+static void analyze_quietly(vector<lexical_error>& errors, Analyze analyze)
+{
+    ostream* output = error_output;
+    vector<lexical_error>* log = error_log;
+    const line_index* lines = error_lines;
+    error_output = &discarded_errors;
+    error_log = &errors;
+    error_lines = nullptr;
+    analyze();
+    error_output = output;
+    error_log = log;
+    error_lines = lines;
+}
+
+relex_range incremental_lexical_analysis(token_buffer& token_stream, symbol_table& id_list, symbol_table& str_list, int& line_num, vector<int>& word_type_num,
+    int& char_num, vector<lexical_error>& errors, string& program, const text_edit& edit)
+{
+    size_t offset = min(edit.offset, program.size());
+    size_t deleted = min(edit.deleted, program.size() - offset);
+    int64_t delta = (int64_t)edit.inserted.size() - (int64_t)deleted;
+
+    //没有EOF字符时char_num等于源程序长度
+    bool has_eof = (size_t)char_num != program.size() || memchr(edit.inserted.data(), (unsigned char)EOF, edit.inserted.size()) != nullptr;
+    if (has_eof)
+    {
+        size_t removed = token_stream.size();
+        program.replace(offset, deleted, edit.inserted);
+        token_stream.clear();
+        id_list.clear();
+        str_list.clear();
+        errors.clear();
+        line_num = char_num = 0;
+        word_type_num.assign(WORD_TYPE_AMOUNT, 0);
+        source_buffer view;
+        view.data = program.data();
+        view.size = program.size();
+        analyze_quietly(errors, [&]() { lexical_analysis(token_stream, id_list, str_list, line_num, word_type_num, char_num, view); });
+        return { 0, removed, token_stream.size(), true };
+    }
+
+    //从编辑位置之前第二个记号的起点开始，保证被编辑内容之前的记号不受其后字符的影响
+    //之前不足两个记号时从头开始
+    size_t first = lower_bound_token(token_stream, offset);
+    first = first >= 2 ? first - 2 : 0;
+    size_t restart = first > 0 ? token_stream.offset(first) : 0;
+    size_t candidate = lower_bound_token(token_stream, offset + deleted);   //可能与新记号同步的第一个旧记号
+
+    int newlines = (int)count(edit.inserted.begin(), edit.inserted.end(), '\n') - (int)count(program.begin() + offset, program.begin() + offset + deleted, '\n');
+    program.replace(offset, deleted, edit.inserted);
+
+    token_buffer tokens;
+    vector<lexical_error> new_errors;
+    size_t last = token_stream.size();
+    size_t sync_offset = program.size();
+    analyze_quietly(new_errors, [&]() {
+        source_buffer view;
+        view.data = program.data() + restart;
+        view.size = program.size() - restart;
+        lexer<source_buffer> lex(id_list, str_list, view, (int)restart);
+        struct token token;
+        while (lex.next_token(token))
+        {
+            int64_t token_offset = lex.get_token_offset();
+            while (candidate < token_stream.size() && token_stream.offset(candidate) + delta < token_offset)
+                candidate++;
+            if (candidate < token_stream.size() && token_stream.offset(candidate) + delta == token_offset)
+            {
+                //同步的记号保留旧记号，撤销新记号在符号表中的计数
+                if (token.type == ID)
+                    id_list.add_count(token.value.i, -1);
+                else if (token.type == STRING)
+                    str_list.add_count(token.value.i, -1);
+                else if (token.type == KEYWORD)
+                    id_list.add_keyword_count(token.value.i, -1);
+                last = candidate;
+                sync_offset = token_offset;
+                break;
+            }
+            tokens.push_back(token, (uint32_t)token_offset, lex.get_token_length());
+        }
+    });
+
+    token_buffer::const_iterator it = token_stream.iterator_at(first);
+    for (size_t i = first; i < last; i++, ++it)
+    {
+        struct token token = *it;
+        word_type_num[token.type]--;
+        if (token.type == ID)
+            id_list.add_count(token.value.i, -1);
+        else if (token.type == STRING)
+            str_list.add_count(token.value.i, -1);
+        else if (token.type == KEYWORD)
+            id_list.add_keyword_count(token.value.i, -1);
+    }
+    for (size_t i = 0; i < tokens.size(); i++)
+        word_type_num[tokens.type(i)]++;
+    line_num += newlines;
+    char_num += (int)delta;
+
+    //同步点之前的错误换成新的错误，同步点之后的错误平移
+    size_t error_first = lower_bound_error(errors, restart);
+    size_t error_last = lower_bound_error(errors, sync_offset - delta);
+    if (last == token_stream.size())
+        error_last = errors.size();
+    for (size_t i = error_last; i < errors.size(); i++)
+        errors[i].offset += delta;
+    new_errors.erase(new_errors.begin() + lower_bound_error(new_errors, sync_offset), new_errors.end());
+    errors.erase(errors.begin() + error_first, errors.begin() + error_last);
+    errors.insert(errors.begin() + error_first, new_errors.begin(), new_errors.end());
+
+    token_stream.replace(first, last, tokens, delta);
+    return { first, last - first, tokens.size(), false };
+}
@@ -0,0 +1,42 @@
+﻿#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "token_buffer.h"
+#include "symbol_table.h"
+#include "lexical_analysis.h"
+
+//对源程序的一次编辑：从offset起删除deleted个字节，再插入inserted
+struct text_edit
+{
+    size_t offset;
+    size_t deleted;
+    std::string_view inserted;
+};
+
+//增量分析的结果：记号流中从first_token起的removed个旧记号被替换为inserted个新记号，其余记号只有偏移改变
+struct relex_range
+{
+    size_t first_token;
+    size_t removed;
+    size_t inserted;
+    bool full;          //是否对整个源程序重新分析
+};
+
+/**
+ * 对编辑后的源程序增量地重新分析，用于编辑器中的实时语法高亮
+ * 从编辑位置之前的记号边界（此处DFA一定处于状态0）开始重新分析，直到新的记号与编辑位置之后的某个旧记号起始于同一位置：
+ * 此时DFA处于状态0且之后的内容相同，其后的记号与旧记号完全相同，只需平移偏移，然后把新记号替换进记号流
+ * 多行注释不产生记号，在注释中（状态23、24）不会与旧记号同步，插入注释开头或删除注释结尾时会一直分析到注释的新结尾
+ * 源程序中含有EOF字符（0xFF）时分析的终点可能改变，直接整体重新分析
+ * 标志符表和字符串表只增不减，未改变的记号编号不变，新出现的标志符和字符串追加在表末尾，因此编号不再按首次出现的顺序
+ * token_buffer& token_stream - 编辑前的记号流，返回编辑后的记号流
+ * symbol_table& id_list, symbol_table& str_list - 标志符表和字符串表
+ * int& line_num, std::vector<int>& word_type_num, int& char_num - 整个源程序的统计结果，随编辑更新
+ * std::vector<lexical_error>& errors - 整个源程序的词法错误，按偏移排序，随编辑更新
+ * std::string& program - 编辑前的源程序，返回编辑后的源程序
+ * const text_edit& edit - 编辑，offset和deleted超出源程序时截断到末尾
+ */
+relex_range incremental_lexical_analysis(token_buffer& token_stream, symbol_table& id_list, symbol_table& str_list, int& line_num, std::vector<int>& word_type_num,
+    int& char_num, std::vector<lexical_error>& errors, std::string& program, const text_edit& edit);
@@ -0,0 +1,61 @@
+﻿#pragma once
+#include <string_view>
+
+//C语言关键字，按字典序排列，下标即为记号<KW, n>中的n
+constexpr std::string_view KEYWORD_NAMES[] = { "auto", "break", "case", "char", "const", "continue", "default", "do", "double",
+"else", "enum", "extern", "float", "for", "goto", "if", "int", "long", "register",
+"return", "short", "signed", "sizeof", "static", "struct", "switch", "typedef", "union", "unsigned",
+"void", "volatile", "while" };
+
+constexpr int KEYWORD_AMOUNT = sizeof(KEYWORD_NAMES) / sizeof(KEYWORD_NAMES[0]);
+constexpr int KEYWORD_MIN_LENGTH = 2;
+constexpr int KEYWORD_MAX_LENGTH = 8;
+constexpr unsigned KEYWORD_HASH_SIZE = 64;
+
+/**
+ * 关键字完美哈希函数，由首字符、第二个字符、末字符和长度计算
+ * 对KEYWORD_NAMES中的32个关键字无冲突，调用前需保证str.size() >= KEYWORD_MIN_LENGTH
+ */
+constexpr unsigned keyword_hash(std::string_view str)
+{
+    return ((unsigned char)str[0] * 15u + (unsigned char)str[1] * 14u + (unsigned char)str.back() + (unsigned)str.size()) & (KEYWORD_HASH_SIZE - 1);
+}
+
+struct keyword_hash_table
+{
+    signed char entry[KEYWORD_HASH_SIZE];   //哈希值对应的关键字下标，-1表示没有关键字
+    bool perfect;                           //是否没有冲突
+};
+
+//在编译期生成关键字哈希表
+constexpr keyword_hash_table make_keyword_hash_table()
+{
+    keyword_hash_table table = {};
+    table.perfect = true;
+    for (unsigned i = 0; i < KEYWORD_HASH_SIZE; i++)
+        table.entry[i] = -1;
+    for (int i = 0; i < KEYWORD_AMOUNT; i++)
+    {
+        unsigned h = keyword_hash(KEYWORD_NAMES[i]);
+        if (table.entry[h] != -1)
+            table.perfect = false;
+        table.entry[h] = i;
+    }
+    return table;
+}
+
+constexpr keyword_hash_table KEYWORD_HASH_TABLE = make_keyword_hash_table();
+static_assert(KEYWORD_HASH_TABLE.perfect, "keyword_hash has collisions on KEYWORD_NAMES");
+
+//查找str在KEYWORD_NAMES中的位置，若是关键字返回位置，否者返回-1
+constexpr int keyword_lookup(std::string_view str)
+{
+    if (str.size() < KEYWORD_MIN_LENGTH || str.size() > KEYWORD_MAX_LENGTH)
+        return -1;
+    int i = KEYWORD_HASH_TABLE.entry[keyword_hash(str)];
+    if (i != -1 && KEYWORD_NAMES[i] == str)
+        return i;
+    return -1;
+}
+
+static_assert(keyword_lookup("while") == 31 && keyword_lookup("auto") == 0 && keyword_lookup("whilst") == -1, "keyword_lookup is inconsistent with KEYWORD_NAMES");
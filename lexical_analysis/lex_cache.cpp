@@ -0,0 +1,75 @@
+﻿#include "lex_cache.h"
+#include "content_hash.h"
+#include "lexical_analysis.h"
+#include "token_file.h"
+#include <cstdio>
+#include <filesystem>
+#include <random>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+lex_cache::lex_cache(const string& directory) : directory(directory), salt(random_device()())
+{
+    error_code ec;
+    fs::create_directories(directory, ec);
+}
+
+string lex_cache::entry_path(uint64_t hash) const
+{
+    char name[24];
+    snprintf(name, sizeof(name), "%016llx.tok", (unsigned long long)hash);
+    return (fs::path(directory) / name).string();
+}
+
+void lex_cache::analyze(token_buffer& token_stream, symbol_table& id_list, symbol_table& str_list, int& line_num, vector<int>& word_type_num, int& char_num,
+    source_buffer& program, bool use_table)
+{
+    //缓存文件只保存一个源程序的结果，已有内容时无法与之合并保存
+    bool cacheable = token_stream.empty() && id_list.size() == 0 && str_list.size() == 0;
+    //词法分析器的版本作为哈希的种子，分析结果改变后旧的缓存文件不会再命中
+    string path = cacheable ? entry_path(content_hash(program.data, program.size, LEXER_VERSION)) : string();
+    if (cacheable)
+    {
+        token_file file;
+        if (file.open(path))
+        {
+            hits++;
+            file.load(token_stream, id_list, str_list, line_num, word_type_num, char_num);
+            for (const lexical_error& entry : file.get_errors())
+                error(entry.word, entry.offset);
+            return;
+        }
+    }
+    misses++;
+
+    int start_line_num = line_num;
+    int start_char_num = char_num;
+    vector<int> start_word_type_num = word_type_num;
+    vector<lexical_error> errors;
+    vector<lexical_error>* log = error_log;
+    error_log = &errors;
+    if (use_table)
+        table_lexical_analysis(token_stream, id_list, str_list, line_num, word_type_num, char_num, program);
+    else
+        lexical_analysis(token_stream, id_list, str_list, line_num, word_type_num, char_num, program);
+    error_log = log;
+    if (log)
+        log->insert(log->end(), errors.begin(), errors.end());
+    if (!cacheable)
+        return;
+
+    //缓存中只保存本次分析的统计结果
+    for (size_t i = 0; i < word_type_num.size(); i++)
+        start_word_type_num[i] = word_type_num[i] - start_word_type_num[i];
+    string temp = path + ".tmp" + std::to_string(salt) + "-" + std::to_string(temp_id++);
+    if (!write_token_file(temp, token_stream, id_list, str_list, line_num - start_line_num, start_word_type_num, char_num - start_char_num, errors))
+    {
+        remove(temp.c_str());
+        return;
+    }
+    error_code ec;
+    fs::rename(temp, path, ec);
+    if (ec)
+        remove(temp.c_str());
+}
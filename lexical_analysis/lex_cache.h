@@ -0,0 +1,45 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "token_buffer.h"
+#include "symbol_table.h"
+#include "source_buffer.h"
+
+/**
+ * 以源程序内容为键的词法分析缓存
+ * 每个源程序按其全部字节以LEXER_VERSION为种子的XXH64哈希值保存为缓存目录下的一个二进制记号文件（token_file），
+ * 保存记号流、标志符表、字符串表、统计结果和词法错误；内容相同的源程序命中后直接读回结果，不再分析
+ * 多个线程可以同时使用同一个缓存，缓存文件先写入临时文件再改名，读取方不会看到写了一半的文件
+ */
+class lex_cache
+{
+public:
+    //缓存目录不存在时自动创建
+    explicit lex_cache(const std::string& directory);
+
+    lex_cache(const lex_cache&) = delete;
+    lex_cache& operator=(const lex_cache&) = delete;
+
+    /**
+     * 分析program，缓存命中时从缓存读回结果并按当前的error_lines重新报告保存的词法错误，未命中时分析后写入缓存
+     * 参数与lexical_analysis相同
+     * bool use_table - 未命中时是否使用表驱动DFA，两种DFA的结果相同，共用同一份缓存
+     */
+    void analyze(token_buffer& token_stream, symbol_table& id_list, symbol_table& str_list, int& line_num, std::vector<int>& word_type_num, int& char_num,
+        source_buffer& program, bool use_table = false);
+
+    size_t get_hits() const { return hits; }
+    size_t get_misses() const { return misses; }
+
+private:
+    std::string entry_path(uint64_t hash) const;
+
+    std::string directory;
+    std::atomic<size_t> hits{ 0 };
+    std::atomic<size_t> misses{ 0 };
+    unsigned salt;                      //临时文件名中的随机数，避免多个进程写同一个临时文件
+    std::atomic<size_t> temp_id{ 0 };   //临时文件的序号，避免多个线程写同一个临时文件
+};
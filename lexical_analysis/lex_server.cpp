@@ -0,0 +1,610 @@
+﻿#include "lex_server.h"
+#include "lexer_session.h"
+#include "thread_pool.h"
+#include "token_file.h"
+#include "output_buffer.h"
+#include "line_index.h"
+#include "corpus_generator.h"
+#include "batch.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifndef _WIN32
+
+//读取缓冲区的大小，流水线中连续的多个小请求可以一次读入
+const size_t READ_BUFFER_SIZE = 64 * 1024;
+
+//一次写出的最多响应数
+const int WRITE_BATCH = 16;
+
+//预热会话使用的合成源程序的字节数，不超过它的源程序分析时会话不再分配
+const size_t WARMUP_SIZE = 256 * 1024;
+
+//请求结束后槽中字符串保留的最大容量，超过时释放，偶尔的大请求不会一直占用连接的内存
+const size_t SLOT_KEEP_SIZE = 1024 * 1024;
+
+//以内容发送的源程序在文本响应中报告词法错误时使用的名称
+const string SOURCE_NAME = "<source>";
+
+static void put_header(char* header, uint8_t kind, uint8_t format, uint32_t size)
+{
+    header[0] = kind;
+    header[1] = format;
+    header[2] = 0;
+    header[3] = 0;
+    for (int i = 0; i < 4; i++)
+        header[4 + i] = (char)(size >> (8 * i));
+}
+
+static uint32_t header_size(const char* header)
+{
+    uint32_t size = 0;
+    for (int i = 0; i < 4; i++)
+        size |= (uint32_t)(uint8_t)header[4 + i] << (8 * i);
+    return size;
+}
+
+static bool make_address(const string& path, sockaddr_un& address)
+{
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        return false;
+    memcpy(address.sun_path, path.data(), path.size());
+    return true;
+}
+
+/**
+ * 从fd读取n字节到dest
+ * 先取走buffer中[begin, end)已读入的数据，不足时每次尽量读满buffer；剩余部分不小于buffer时直接读入dest
+ * 连接关闭或出错时返回false
+ */
+static bool read_exact(int fd, vector<char>& buffer, size_t& begin, size_t& end, char* dest, size_t n)
+{
+    while (n > 0)
+    {
+        if (begin == end)
+        {
+            bool direct = n >= buffer.size();
+            ssize_t count = direct ? read(fd, dest, n) : read(fd, buffer.data(), buffer.size());
+            if (count < 0 && errno == EINTR)
+                continue;
+            if (count <= 0)
+                return false;
+            if (direct)
+            {
+                dest += count;
+                n -= count;
+                continue;
+            }
+            begin = 0;
+            end = count;
+        }
+        size_t length = min(n, end - begin);
+        memcpy(dest, buffer.data() + begin, length);
+        begin += length;
+        dest += length;
+        n -= length;
+    }
+    return true;
+}
+
+//写出iov中的全部数据，只写出一部分时继续；对方已关闭连接时返回false，不产生SIGPIPE
+static bool write_all(int fd, iovec* iov, int count)
+{
+    while (count > 0)
+    {
+        msghdr message = {};
+        message.msg_iov = iov;
+        message.msg_iovlen = count;
+        ssize_t written = sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written < 0)
+            return false;
+        while (count > 0 && (size_t)written >= iov->iov_len)
+        {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+struct server_connection;
+
+//连接上正在处理的请求，请求按序号循环使用连接的SERVER_WINDOW个槽，槽中的字符串在请求之间重复使用
+struct server_request
+{
+    server_connection* owner = nullptr;
+    uint8_t kind = 0;
+    uint8_t format = 0;
+    bool done = false;          //响应已生成，等待按顺序写出
+    string content;
+    string response;            //含帧头
+};
+
+/**
+ * 一个客户端连接
+ * 读取线程收取请求并交给线程池，工作线程只分析，完成后标记槽并通知；响应由连接自己的写出线程按请求顺序写出，
+ * 写出时不持有锁，其间完成的请求在下一轮一起写出。对方不读取响应时只有该连接的写出线程阻塞，不占用工作线程
+ */
+struct server_connection
+{
+    int fd = -1;
+    mutex lock;
+    condition_variable progress;        //有响应写出
+    condition_variable completed;       //有请求完成或读取结束
+    server_request requests[SERVER_WINDOW];
+    uint64_t received = 0;              //已收到的请求数，只由读取线程修改
+    uint64_t sent = 0;                  //已写出的响应数
+    bool closing = false;               //读取已结束，不再有新请求
+    bool broken = false;                //写出失败，之后的响应不再写出
+};
+
+class lex_server
+{
+public:
+    explicit lex_server(int thread_num);
+    ~lex_server();
+
+    int size() const { return pool.size(); }
+
+    //收取并处理一个连接的请求，直到连接关闭，在每个连接自己的线程中运行
+    void handle(int fd);
+
+private:
+    void process(int worker, server_request& request);
+    static void complete(server_request& request);
+    static void write_responses(server_connection& connection);
+
+    thread_pool pool;
+    vector<unique_ptr<lexer_session>> sessions;     //每个工作线程一个
+    mutex lock;
+    condition_variable idle;
+    int active = 0;                                 //正在处理的连接数
+};
+
+lex_server::lex_server(int thread_num) : pool(thread_num)
+{
+    //预先分析一份合成源程序，使各会话的记号流和符号表达到常见源程序所需的容量
+    string warmup = generate_corpus(BALANCED_MIX, WARMUP_SIZE);
+    for (int i = 0; i < pool.size(); i++)
+    {
+        sessions.push_back(make_unique<lexer_session>());
+        sessions.back()->analyze(warmup);
+        sessions.back()->reset();
+    }
+}
+
+lex_server::~lex_server()
+{
+    unique_lock<mutex> guard(lock);
+    idle.wait(guard, [this] { return active == 0; });
+}
+
+void lex_server::handle(int fd)
+{
+    {
+        lock_guard<mutex> guard(lock);
+        active++;
+    }
+    unique_ptr<server_connection> connection = make_unique<server_connection>();
+    connection->fd = fd;
+    for (server_request& request : connection->requests)
+        request.owner = connection.get();
+
+    thread writer(&lex_server::write_responses, ref(*connection));
+
+    vector<char> buffer(READ_BUFFER_SIZE);
+    size_t begin = 0;
+    size_t end = 0;
+    char header[FRAME_HEADER_SIZE];
+    while (read_exact(fd, buffer, begin, end, header, FRAME_HEADER_SIZE))
+    {
+        uint32_t size = header_size(header);
+        if (size > MAX_REQUEST_SIZE || header[2] != 0 || header[3] != 0)
+            break;
+        {
+            unique_lock<mutex> guard(connection->lock);
+            connection->progress.wait(guard, [&] { return connection->received - connection->sent < SERVER_WINDOW || connection->broken; });
+            if (connection->broken)
+                break;
+        }
+        server_request& request = connection->requests[connection->received % SERVER_WINDOW];
+        request.kind = header[0];
+        request.format = header[1];
+        //内容随读入分段增长，帧头声明的长度不会在内容到达之前就占用内存
+        request.content.clear();
+        bool arrived = true;
+        for (uint32_t left = size; left > 0 && arrived; )
+        {
+            size_t length = min<size_t>(left, READ_BUFFER_SIZE);
+            size_t offset = request.content.size();
+            request.content.resize(offset + length);
+            arrived = read_exact(fd, buffer, begin, end, request.content.data() + offset, length);
+            left -= (uint32_t)length;
+        }
+        if (!arrived)
+            break;
+        {
+            lock_guard<mutex> guard(connection->lock);
+            connection->received++;
+        }
+        pool.submit([this, &request](int worker) { process(worker, request); });
+    }
+
+    //写出线程写出已收到的请求的全部响应后结束，之后再关闭连接
+    {
+        lock_guard<mutex> guard(connection->lock);
+        connection->closing = true;
+    }
+    connection->completed.notify_all();
+    writer.join();
+    close(fd);
+    connection.reset();
+    lock_guard<mutex> guard(lock);
+    active--;
+    idle.notify_all();
+}
+
+//按命令行程序的格式输出分析结果，其后每行一个词法错误
+static void format_text(string& response, const lexer_session& session, const string& name)
+{
+    output_buffer output(response);
+    print_analysis(output, session.get_token_stream(), session.get_id_list(), session.get_str_list(),
+        session.get_line_num(), session.get_word_type_num(), session.get_char_num());
+    if (session.get_errors().empty())
+        return;
+    line_index lines(name, session.get_source().data(), session.get_source().size());
+    for (const lexical_error& error : session.get_errors())
+    {
+        source_location location = lines.locate(error.offset);
+        output.append(name);
+        output.append(':');
+        output.append(location.line);
+        output.append(':');
+        output.append(location.column);
+        output.append(": error: ");
+        output.append(error.word);
+        output.append('\n');
+    }
+}
+
+void lex_server::process(int worker, server_request& request)
+{
+    lexer_session& session = *sessions[worker];
+    string& response = request.response;
+    response.assign(FRAME_HEADER_SIZE, '\0');
+    response_status status = RESPONSE_OK;
+    if ((request.kind != REQUEST_PATH && request.kind != REQUEST_SOURCE) || (request.format != FORMAT_BINARY && request.format != FORMAT_TEXT))
+        status = RESPONSE_BAD_REQUEST;
+    else if (request.kind == REQUEST_PATH && !session.analyze_file(request.content))
+        status = RESPONSE_CANNOT_OPEN;
+    else
+    {
+        if (request.kind == REQUEST_SOURCE)
+            session.analyze(request.content);
+        if (request.format == FORMAT_BINARY)
+            encode_token_file(response, session.get_token_stream(), session.get_id_list(), session.get_str_list(),
+                session.get_line_num(), session.get_word_type_num(), session.get_char_num(), session.get_errors());
+        else
+            format_text(response, session, request.kind == REQUEST_PATH ? request.content : SOURCE_NAME);
+    }
+    //释放映射的源程序，保留会话的空间
+    session.reset();
+    put_header(response.data(), status, request.format, (uint32_t)(response.size() - FRAME_HEADER_SIZE));
+    complete(request);
+}
+
+void lex_server::complete(server_request& request)
+{
+    //持有锁时通知：写出线程看到最后一个响应完成后连接即可能被销毁
+    server_connection& connection = *request.owner;
+    lock_guard<mutex> guard(connection.lock);
+    request.done = true;
+    connection.completed.notify_all();
+}
+
+//连接的写出线程：等待从sent开始的请求完成后按顺序写出，读取结束且全部写出后返回
+void lex_server::write_responses(server_connection& connection)
+{
+    unique_lock<mutex> guard(connection.lock);
+    while (true)
+    {
+        connection.completed.wait(guard, [&] {
+            return connection.requests[connection.sent % SERVER_WINDOW].done || (connection.closing && connection.sent == connection.received);
+        });
+        if (!connection.requests[connection.sent % SERVER_WINDOW].done)
+            return;
+
+        //取出从sent开始连续完成的响应一起写出
+        iovec iov[WRITE_BATCH];
+        int count = 0;
+        for (uint64_t i = connection.sent; count < WRITE_BATCH && connection.requests[i % SERVER_WINDOW].done; i++, count++)
+        {
+            string& response = connection.requests[i % SERVER_WINDOW].response;
+            iov[count].iov_base = response.data();
+            iov[count].iov_len = response.size();
+        }
+        bool broken = connection.broken;
+        guard.unlock();
+        if (!broken && !write_all(connection.fd, iov, count))
+            broken = true;
+        guard.lock();
+        connection.broken = broken;
+        for (int i = 0; i < count; i++)
+        {
+            server_request& request = connection.requests[(connection.sent + i) % SERVER_WINDOW];
+            request.done = false;
+            if (request.content.capacity() > SLOT_KEEP_SIZE)
+                string().swap(request.content);
+            if (request.response.capacity() > SLOT_KEEP_SIZE)
+                string().swap(request.response);
+        }
+        connection.sent += count;
+        connection.progress.notify_all();
+    }
+}
+
+bool serve(const string& socket_path, int thread_num)
+{
+    sockaddr_un address;
+    if (!make_address(socket_path, address))
+        return false;
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+        return false;
+    unlink(socket_path.c_str());
+    if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0)
+    {
+        close(listener);
+        return false;
+    }
+
+    lex_server server(thread_num);
+    cerr << "lexing server listening on " << socket_path << " with " << server.size() << " workers" << endl;
+    while (true)
+    {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            break;
+        }
+        thread(&lex_server::handle, &server, fd).detach();
+    }
+    close(listener);
+    return false;
+}
+
+bool lex_client::connect(const string& socket_path)
+{
+    close();
+    sockaddr_un address;
+    if (!make_address(socket_path, address))
+        return false;
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return false;
+    if (::connect(fd, (sockaddr*)&address, sizeof(address)) != 0)
+    {
+        close();
+        return false;
+    }
+    buffer.resize(READ_BUFFER_SIZE);
+    begin = 0;
+    end = 0;
+    return true;
+}
+
+void lex_client::close()
+{
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+}
+
+bool lex_client::send(request_kind kind, response_format format, string_view content)
+{
+    char header[FRAME_HEADER_SIZE];
+    put_header(header, kind, format, (uint32_t)content.size());
+    iovec iov[2];
+    iov[0].iov_base = header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = (void*)content.data();
+    iov[1].iov_len = content.size();
+    return fd >= 0 && write_all(fd, iov, 2);
+}
+
+bool lex_client::receive(response_status& status, string& content)
+{
+    char header[FRAME_HEADER_SIZE];
+    if (fd < 0 || !read_exact(fd, buffer, begin, end, header, FRAME_HEADER_SIZE))
+        return false;
+    status = (response_status)header[0];
+    content.resize(header_size(header));
+    return read_exact(fd, buffer, begin, end, content.data(), content.size());
+}
+
+#else
+
+bool serve(const string& socket_path, int thread_num)
+{
+    cerr << "the lexing server requires Unix domain sockets" << endl;
+    return false;
+}
+
+bool lex_client::connect(const string& socket_path)
+{
+    return false;
+}
+
+void lex_client::close()
+{
+}
+
+bool lex_client::send(request_kind kind, response_format format, string_view content)
+{
+    return false;
+}
+
+bool lex_client::receive(response_status& status, string& content)
+{
+    return false;
+}
+
+#endif
+
+bool load_test(ostream& out, const string& socket_path, const vector<string>& paths, bool send_source, response_format format,
+    int connections, int depth, int requests)
+{
+    connections = max(connections, 1);
+    depth = clamp(depth, 1, SERVER_WINDOW);
+
+    //请求的内容（路径或源程序）和源程序的字节数
+    vector<string> contents;
+    vector<size_t> sizes;
+    if (paths.empty())
+    {
+        send_source = true;
+        for (int i = 0; i < 1000; i++)
+        {
+            contents.push_back(generate_corpus((corpus_mix)(i % CORPUS_MIX_AMOUNT), 4096, i + 1));
+            sizes.push_back(contents.back().size());
+        }
+    }
+    for (const string& file : collect_sources(paths))
+    {
+        error_code ec;
+        sizes.push_back(filesystem::file_size(file, ec));
+        if (!send_source)
+        {
+            contents.push_back(filesystem::absolute(file, ec).string());
+            continue;
+        }
+        ifstream source(file, ios::binary);
+        if (!source)
+        {
+            out << "cannot open " << file << endl;
+            return false;
+        }
+        contents.emplace_back(istreambuf_iterator<char>(source), istreambuf_iterator<char>());
+    }
+    if (contents.empty())
+    {
+        out << "no source files" << endl;
+        return false;
+    }
+    request_kind kind = send_source ? REQUEST_SOURCE : REQUEST_PATH;
+
+    //每个连接一个线程，保持depth个已发送但未收到响应的请求；第i个连接发送第i、i+connections、...个请求
+    vector<vector<double>> latencies(connections);
+    vector<size_t> source_bytes(connections);
+    vector<size_t> response_bytes(connections);
+    atomic<int> failures(0);
+    atomic<bool> disconnected(false);
+    vector<thread> threads;
+    auto start = chrono::steady_clock::now();
+    for (int c = 0; c < connections; c++)
+    {
+        threads.emplace_back([&, c] {
+            lex_client client;
+            if (!client.connect(socket_path))
+            {
+                disconnected = true;
+                return;
+            }
+            size_t count = requests / connections + (c < requests % connections);
+            vector<chrono::steady_clock::time_point> send_times(depth);
+            latencies[c].reserve(count);
+            string response;
+            response_status status;
+            for (size_t sent = 0, received = 0; received < count; received++)
+            {
+                for (; sent < count && sent - received < (size_t)depth; sent++)
+                {
+                    size_t i = (c + sent * connections) % contents.size();
+                    send_times[sent % depth] = chrono::steady_clock::now();
+                    source_bytes[c] += sizes[i];
+                    if (!client.send(kind, format, contents[i]))
+                    {
+                        disconnected = true;
+                        return;
+                    }
+                }
+                if (!client.receive(status, response))
+                {
+                    disconnected = true;
+                    return;
+                }
+                latencies[c].push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - send_times[received % depth]).count());
+                response_bytes[c] += response.size();
+                //每个连接检查第一个二进制响应能否作为记号文件读回
+                bool valid = status == RESPONSE_OK;
+                if (valid && received == 0 && format == FORMAT_BINARY)
+                {
+                    token_file file;
+                    valid = file.open(response.data(), response.size());
+                }
+                if (!valid)
+                    failures++;
+            }
+        });
+    }
+    for (thread& t : threads)
+        t.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (disconnected)
+    {
+        out << "cannot talk to the lexing server on " << socket_path << endl;
+        return false;
+    }
+
+    vector<double> all;
+    size_t total_source = 0;
+    size_t total_response = 0;
+    for (int c = 0; c < connections; c++)
+    {
+        all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+        total_source += source_bytes[c];
+        total_response += response_bytes[c];
+    }
+    sort(all.begin(), all.end());
+    auto percentile = [&](double p) { return all.empty() ? 0.0 : all[min(all.size() - 1, (size_t)(p * all.size()))]; };
+
+    out << "requests: " << all.size() << " (" << (send_source ? "source" : "path") << ", " << (format == FORMAT_BINARY ? "binary" : "text")
+        << " responses) over " << connections << " connections, pipeline depth " << depth << endl;
+    out << "failed: " << failures << endl;
+    out << "throughput: " << all.size() / seconds << " requests/s, " << total_source / seconds / 1e6 << " MB/s of source, "
+        << total_response / seconds / 1e6 << " MB/s of responses" << endl;
+    out << "latency: p50 " << percentile(0.5) << " ms, p99 " << percentile(0.99) << " ms, max " << (all.empty() ? 0.0 : all.back()) << " ms" << endl;
+    return failures == 0;
+}
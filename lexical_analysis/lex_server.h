@@ -0,0 +1,89 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * 词法分析服务的协议
+ * 请求和响应都由8字节的帧头和内容组成，帧头依次为1字节请求种类（响应为状态）、1字节输出格式、2字节0和4字节小端的内容长度
+ * 请求的内容为源程序路径（相对服务进程的工作目录）或源程序本身；响应的内容为二进制记号文件（与--write-tokens的格式相同，
+ * 含词法错误），或与命令行程序相同的文本输出，其后每行一个词法错误
+ * 同一连接上可以连续发送多个请求而不等待响应，响应按请求的顺序返回
+ */
+enum request_kind : uint8_t
+{
+    REQUEST_PATH = 1,
+    REQUEST_SOURCE = 2
+};
+
+enum response_format : uint8_t
+{
+    FORMAT_BINARY = 0,
+    FORMAT_TEXT = 1
+};
+
+enum response_status : uint8_t
+{
+    RESPONSE_OK = 0,
+    RESPONSE_CANNOT_OPEN = 1,    //路径无法打开
+    RESPONSE_BAD_REQUEST = 2     //请求种类或输出格式无效，内容被忽略
+};
+
+constexpr size_t FRAME_HEADER_SIZE = 8;
+
+//单个请求内容的最大长度，超过时或帧头的保留字节不为0时关闭连接；内容随读入增长，不按声明的长度预先分配
+constexpr uint32_t MAX_REQUEST_SIZE = 1u << 30;
+
+//每个连接上同时处理的请求数，已收到但尚未返回响应的请求达到该数时暂停读取
+constexpr int SERVER_WINDOW = 64;
+
+/**
+ * 在Unix域套接字socket_path上运行词法分析服务，直到出错
+ * 每个工作线程有一个预热过的lexer_session，各连接的请求交给线程池分析，同一连接的多个请求也可由不同线程同时分析
+ * 已存在的socket_path会先被删除
+ * int thread_num - 工作线程数，为0时使用硬件并发数
+ * 无法监听时返回false
+ */
+bool serve(const std::string& socket_path, int thread_num = 0);
+
+//词法分析服务的客户端，请求可以连续发送，响应按发送顺序读取
+class lex_client
+{
+public:
+    lex_client() = default;
+    ~lex_client() { close(); }
+
+    lex_client(const lex_client&) = delete;
+    lex_client& operator=(const lex_client&) = delete;
+
+    bool connect(const std::string& socket_path);
+    void close();
+
+    bool send(request_kind kind, response_format format, std::string_view content);
+
+    //读取下一个响应，内容写入content（重复使用其空间），连接关闭或出错时返回false
+    bool receive(response_status& status, std::string& content);
+
+private:
+    int fd = -1;
+    std::vector<char> buffer;       //已读入但尚未取走的数据
+    size_t begin = 0;
+    size_t end = 0;
+};
+
+/**
+ * 词法分析服务的压力测试，用多个连接同时发送请求，每个连接保持depth个未完成的请求，输出requests/s、MB/s和延迟的p50、p99
+ * 延迟为请求发送到收到响应的时间，包括在流水线中排队的时间
+ * const std::vector<std::string>& paths - 源程序文件或目录（同--batch），为空时使用生成的约4KB的合成源程序并以内容发送
+ * bool send_source - 以内容发送源程序而不是发送路径，路径发送前转换为绝对路径
+ * response_format format - 响应格式
+ * int connections - 连接数
+ * int depth - 每个连接的流水线深度，不超过SERVER_WINDOW
+ * int requests - 请求总数
+ * 全部请求都成功返回true
+ */
+bool load_test(std::ostream& out, const std::string& socket_path, const std::vector<std::string>& paths, bool send_source, response_format format,
+    int connections = 4, int depth = 8, int requests = 20000);
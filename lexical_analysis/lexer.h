@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "token.h"
+#include "symbol_table.h"
+#include "literal.h"
+
+struct chunk_control;
+
+/**
+ * 可恢复的词法分析器（switch实现的DFA）
+ * DFA的状态、当前单词和统计数据都保存为成员，每次调用next_token分析到下一个记号为止，
+ * 使用者可以边分析边处理记号，无需先得到整个记号流；lexical_analysis即在其上逐个收集记号
+ * Source为ifstream（逐字符读取）或source_buffer（在内存中以游标读取）
+ */
+template <class Source>
+class lexer
+{
+public:
+    /**
+     * symbol_table& id_list - 标志符表
+     * symbol_table& str_list - 字符串表
+     * Source& program - 源程序
+     * int char_num - 开始时的字符数，即program起点在整个源程序中的字节偏移，记号和错误的位置由此计算
+     * int state - 开始时的状态，分块重新分析时可以从多行注释状态23、24开始
+     * chunk_control* control - 分块分析的控制信息，整体分析时为nullptr
+     */
+    lexer(symbol_table& id_list, symbol_table& str_list, Source& program, int char_num = 0, int state = 0, chunk_control* control = nullptr);
+
+    /**
+     * 从头分析重新设置过的program，状态和统计数据都回到初始值，已分配的空间保留，用于连续分析多个源程序
+     * 不能用于分块分析
+     */
+    void reset(int char_num = 0, int state = 0);
+
+    //分析出下一个记号，到达EOF（或分块分析结束）时返回false
+    bool next_token(struct token& token);
+
+    int get_line_num() const { return line_num; }                               //行数，到达EOF后包含最后一行
+    int get_char_num() const { return char_num; }                               //已读取的字符总数（含开始时的字符数）
+    const std::vector<int>& get_word_type_num() const { return word_type_num; } //每种单词类型的数量
+    size_t get_token_num() const { return token_num; }                          //已产生的记号数
+    int get_token_offset() const { return token_offset; }                       //上一个记号的字节偏移
+    int get_token_length() const { return token_length; }                       //上一个记号的字节长度
+
+private:
+    symbol_table& id_list;
+    symbol_table& str_list;
+    Source& program;
+    chunk_control* control;
+
+    int state;
+    char c = 0;
+    char last_char = 0;
+    std::string buf;
+    integer_literal number = {};
+    bool finished = false;
+
+    int line_num = 0;
+    int char_num;
+    std::vector<int> word_type_num;
+    size_t token_num = 0;
+    int lexeme_offset = 0;                      //当前单词开始时的char_num
+    int token_offset = 0;
+    int token_length = 0;
+
+    std::vector<struct token> token_stream;     //已识别但尚未取走的记号
+    size_t next_pending = 0;                    //token_stream中下一个取走的记号
+};
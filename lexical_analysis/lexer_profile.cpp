@@ -0,0 +1,151 @@
+﻿#include "lexer_profile.h"
+
+#ifdef LEXER_PROFILE
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+const char* const STATE_NAMES[DFA_STATE_AMOUNT] = { "START", "ID", "DECIMAL", "ZERO", "OCTAL", "HEX_PREFIX", "HEX", "BAD_OCTAL",
+    "FRACTION", "EXPONENT", "EXPONENT_SIGN", "EXPONENT_DIGIT", "CHAR", "STRING", "LESS", "GREATER", "EQUAL", "EXCLAMATION",
+    "PLUS", "MINUS", "STAR", "SLASH", "LINE_COMMENT", "BLOCK_COMMENT", "BLOCK_COMMENT_STAR", "PERCENT", "AMPERSAND", "BAR",
+    "CARET", "DOT", "U_SUFFIX", "L_SUFFIX", "CHAR_ESCAPE", "STRING_ESCAPE", "LSHIFT", "RSHIFT" };
+
+const char* const CHAR_CLASS_NAMES[CHAR_CLASS_AMOUNT] = { "LETTER", "HEX_LETTER", "E", "F", "L", "U", "X", "UNDERSCORE", "DOLLAR",
+    "ZERO", "OCT_DIGIT", "DEC_DIGIT", "DOT", "QUOTE", "DOUBLE_QUOTE", "BACKSLASH", "LESS", "GREATER", "EQUAL", "EXCLAMATION",
+    "PLUS", "MINUS", "STAR", "SLASH", "PERCENT", "AMPERSAND", "BAR", "CARET", "PUNCTUATION", "SPACE", "NEWLINE", "EOF", "OTHER" };
+
+//输出中列出的转移数
+const int PROFILE_TOP_TRANSITIONS = 20;
+
+static mutex finished_mutex;
+static lexer_profile finished = {};     //已结束线程的累计结果
+
+static void add_profile(lexer_profile& total, const lexer_profile& profile)
+{
+    for (int s = 0; s < DFA_STATE_AMOUNT; s++)
+    {
+        total.state_visits[s] += profile.state_visits[s];
+        for (int cc = 0; cc < CHAR_CLASS_AMOUNT; cc++)
+            total.transitions[s][cc] += profile.transitions[s][cc];
+    }
+    total.scanned_bytes += profile.scanned_bytes;
+    total.retracts += profile.retracts;
+    total.probes += profile.probes;
+    for (int i = 0; i < PROFILE_PROBE_BUCKETS; i++)
+        total.probe_histogram[i] += profile.probe_histogram[i];
+    total.max_probes = max(total.max_probes, profile.max_probes);
+    profile_timer lexer_profile::* const timers[] = { &lexer_profile::word_analysis, &lexer_profile::reserve, &lexer_profile::table_insert };
+    for (auto timer : timers)
+    {
+        (total.*timer).calls += (profile.*timer).calls;
+        (total.*timer).ns += (profile.*timer).ns;
+    }
+}
+
+//线程结束时把计数器累加到finished
+struct thread_profile_holder
+{
+    lexer_profile profile = {};
+
+    ~thread_profile_holder()
+    {
+        lock_guard<mutex> lock(finished_mutex);
+        add_profile(finished, profile);
+    }
+};
+
+static thread_local thread_profile_holder holder;
+
+lexer_profile& thread_profile()
+{
+    return holder.profile;
+}
+
+static double percent(uint64_t part, uint64_t total)
+{
+    return total ? 100.0 * part / total : 0.0;
+}
+
+static void print_timer(ostream& out, const char* name, const profile_timer& timer, uint64_t parent_ns)
+{
+    out << "  " << left << setw(16) << name << right << setw(12) << timer.calls << " calls" << setw(10) << timer.ns / 1e6 << " ms"
+        << setw(8) << (timer.calls ? (double)timer.ns / timer.calls : 0.0) << " ns/call";
+    if (parent_ns)
+        out << setw(7) << percent(timer.ns, parent_ns) << "% of word_analysis";
+    out << endl;
+}
+
+void print_lexer_profile(ostream& out)
+{
+    lexer_profile total = {};
+    {
+        lock_guard<mutex> lock(finished_mutex);
+        add_profile(total, finished);
+    }
+    add_profile(total, thread_profile());
+
+    ios_base::fmtflags flags = out.flags();
+    streamsize precision = out.precision();
+    out << fixed << setprecision(1);
+    out << "\nlexer profile:" << endl;
+
+    uint64_t visits = 0;
+    vector<int> states;
+    for (int s = 0; s < DFA_STATE_AMOUNT; s++)
+        if (total.state_visits[s])
+        {
+            visits += total.state_visits[s];
+            states.push_back(s);
+        }
+    sort(states.begin(), states.end(), [&total](int a, int b) { return total.state_visits[a] > total.state_visits[b]; });
+    out << "DFA state visits: " << visits << ", bytes skipped by block scans: " << total.scanned_bytes << endl;
+    for (int s : states)
+        out << "  " << left << setw(20) << STATE_NAMES[s] << right << setw(14) << total.state_visits[s] << setw(7) << percent(total.state_visits[s], visits) << "%" << endl;
+
+    vector<pair<int, int>> transitions;
+    uint64_t transition_num = 0;
+    for (int s = 0; s < DFA_STATE_AMOUNT; s++)
+        for (int cc = 0; cc < CHAR_CLASS_AMOUNT; cc++)
+            if (total.transitions[s][cc])
+            {
+                transition_num += total.transitions[s][cc];
+                transitions.push_back({ s, cc });
+            }
+    sort(transitions.begin(), transitions.end(),
+        [&total](pair<int, int> a, pair<int, int> b) { return total.transitions[a.first][a.second] > total.transitions[b.first][b.second]; });
+    if (transitions.size() > PROFILE_TOP_TRANSITIONS)
+        transitions.resize(PROFILE_TOP_TRANSITIONS);
+    out << "top transitions (state, char class): " << transition_num << " in total" << endl;
+    for (pair<int, int> t : transitions)
+    {
+        uint64_t n = total.transitions[t.first][t.second];
+        out << "  " << left << setw(20) << STATE_NAMES[t.first] << setw(14) << CHAR_CLASS_NAMES[t.second] << right << setw(14) << n
+            << setw(7) << percent(n, transition_num) << "%" << endl;
+    }
+
+    out << "retract calls: " << total.retracts << endl;
+
+    uint64_t inserts = 0;
+    for (int i = 0; i < PROFILE_PROBE_BUCKETS; i++)
+        inserts += total.probe_histogram[i];
+    out << "symbol_table::insert: " << inserts << " calls, " << setprecision(2) << (inserts ? (double)total.probes / inserts : 0.0)
+        << " probes per call, longest " << total.max_probes << setprecision(1) << endl;
+    out << "  probes:";
+    for (int i = 0; i < PROFILE_PROBE_BUCKETS; i++)
+        if (total.probe_histogram[i])
+            out << " " << i + 1 << (i + 1 == PROFILE_PROBE_BUCKETS ? "+" : "") << ":" << total.probe_histogram[i];
+    out << endl;
+
+    //计时本身每次调用约有几十纳秒的开销，reserve和table_insert的耗时包含在word_analysis中
+    out << "timed calls:" << endl;
+    print_timer(out, "word_analysis", total.word_analysis, 0);
+    print_timer(out, "reserve", total.reserve, total.word_analysis.ns);
+    print_timer(out, "table_insert", total.table_insert, total.word_analysis.ns);
+
+    out.flags(flags);
+    out.precision(precision);
+}
+#endif
@@ -0,0 +1,102 @@
+﻿#pragma once
+
+/**
+ * 词法分析热路径插桩，编译时定义LEXER_PROFILE才启用，默认关闭，关闭时各宏展开为空，不影响生成的代码
+ * 统计DFA各状态的访问次数、(状态, 字符类别)转移次数、整块扫描跳过的字节数、retract调用次数、
+ * 符号表插入的探测长度，以及word_analysis、reserve、table_insert的调用次数和耗时
+ * 计数器每个线程一份，线程结束时累加到全局结果，批量分析和分块并行分析的工作线程也计入
+ */
+#ifdef LEXER_PROFILE
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include "dfa_table.h"
+
+//探测长度直方图的桶数，最后一个桶包含更长的探测
+constexpr int PROFILE_PROBE_BUCKETS = 17;
+
+//一类调用的次数和总耗时
+struct profile_timer
+{
+    uint64_t calls;
+    uint64_t ns;
+};
+
+struct lexer_profile
+{
+    uint64_t state_visits[DFA_STATE_AMOUNT];
+    uint64_t transitions[DFA_STATE_AMOUNT][CHAR_CLASS_AMOUNT];
+    int last_state;                             //switch实现上一轮循环的状态
+    uint64_t scanned_bytes;                     //整块扫描跳过的字节数，不经过DFA状态
+    uint64_t retracts;
+    uint64_t probes;                            //符号表插入的探测总数
+    uint64_t probe_histogram[PROFILE_PROBE_BUCKETS];
+    uint64_t max_probes;
+    profile_timer word_analysis;
+    profile_timer reserve;
+    profile_timer table_insert;
+};
+
+//当前线程的计数器
+lexer_profile& thread_profile();
+
+//输出已结束线程和当前线程的统计结果
+void print_lexer_profile(std::ostream& out);
+
+//退出作用域时把经过的时间累加到timer
+class profile_scope
+{
+public:
+    explicit profile_scope(profile_timer& timer) : timer(timer), start(std::chrono::steady_clock::now()) {}
+    ~profile_scope()
+    {
+        timer.calls++;
+        timer.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    profile_timer& timer;
+    std::chrono::steady_clock::time_point start;
+};
+
+//switch实现：每轮循环开始时记录状态，并以上一轮的状态和上一轮读入的字符记录转移
+inline void profile_switch_step(int state, char c)
+{
+    lexer_profile& profile = thread_profile();
+    profile.state_visits[state]++;
+    profile.transitions[profile.last_state][DFA_TABLE.char_class[(unsigned char)c]]++;
+    profile.last_state = state;
+}
+
+//表驱动实现：每读入一个字符记录一次
+inline void profile_table_step(int state, int cc)
+{
+    lexer_profile& profile = thread_profile();
+    profile.state_visits[state]++;
+    profile.transitions[state][cc]++;
+}
+
+inline void profile_probes(size_t probes)
+{
+    lexer_profile& profile = thread_profile();
+    profile.probes += probes;
+    profile.probe_histogram[probes < PROFILE_PROBE_BUCKETS ? probes - 1 : PROFILE_PROBE_BUCKETS - 1]++;
+    if (probes > profile.max_probes)
+        profile.max_probes = probes;
+}
+
+#define PROFILE_SWITCH_STEP(state, c) profile_switch_step(state, c)
+#define PROFILE_TABLE_STEP(state, cc) profile_table_step(state, cc)
+#define PROFILE_SCANNED(bytes) (thread_profile().scanned_bytes += (bytes))
+#define PROFILE_RETRACT() (thread_profile().retracts++)
+#define PROFILE_PROBES(probes) profile_probes(probes)
+#define PROFILE_SCOPE(timer) profile_scope profile_scope_##timer(thread_profile().timer)
+#else
+#define PROFILE_SWITCH_STEP(state, c) ((void)0)
+#define PROFILE_TABLE_STEP(state, cc) ((void)0)
+#define PROFILE_SCANNED(bytes) ((void)0)
+#define PROFILE_RETRACT() ((void)0)
+#define PROFILE_PROBES(probes) ((void)0)
+#define PROFILE_SCOPE(timer) ((void)0)
+#endif
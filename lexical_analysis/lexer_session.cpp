@@ -0,0 +1,101 @@
+﻿#include "lexer_session.h"
+#include <algorithm>
+#include <cerrno>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+//fd不是普通文件（管道、套接字）时第一次读取的大小
+const size_t FD_READ_SIZE = 64 * 1024;
+
+lexer_session::lexer_session() : lex(id_list, str_list, program)
+{
+}
+
+void lexer_session::reset()
+{
+    token_stream.clear();
+    id_list.clear();
+    str_list.clear();
+    errors.clear();
+    close_source(program);
+    lex.reset();
+}
+
+void lexer_session::run()
+{
+    ostream* output = error_output;
+    vector<lexical_error>* log = error_log;
+    error_output = nullptr;
+    error_log = &errors;
+    struct token token;
+    while (lex.next_token(token))
+        token_stream.push_back(token, lex.get_token_offset(), lex.get_token_length());
+    error_output = output;
+    error_log = log;
+}
+
+void lexer_session::analyze(string_view source)
+{
+    reset();
+    program.data = source.data();
+    program.size = source.size();
+    run();
+}
+
+bool lexer_session::analyze_file(const string& path)
+{
+    reset();
+    if (!open_source(program, path))
+        return false;
+    run();
+    return true;
+}
+
+bool lexer_session::analyze_fd(int fd)
+{
+    reset();
+    size_t size = 0;
+    size_t capacity = FD_READ_SIZE;
+#ifndef _WIN32
+    //普通文件按文件大小读取，多留1字节以便一次read即可读到文件结束
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+        capacity = st.st_size + 1;
+#endif
+    //缩短input不会释放空间，之后的文件不超过已有容量时不再分配
+    input.resize(capacity);
+    while (true)
+    {
+        if (size == input.size())
+            input.resize(input.size() * 2);
+#ifdef _WIN32
+        int n = _read(fd, &input[size], (unsigned)min(input.size() - size, (size_t)1 << 30));
+#else
+        ssize_t n = read(fd, &input[size], input.size() - size);
+#endif
+        if (n < 0)
+        {
+#ifndef _WIN32
+            if (errno == EINTR)
+                continue;
+#endif
+            input.clear();
+            return false;
+        }
+        if (n == 0)
+            break;
+        size += n;
+    }
+    input.resize(size);
+    program.data = input.data();
+    program.size = input.size();
+    run();
+    return true;
+}
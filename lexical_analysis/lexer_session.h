@@ -0,0 +1,63 @@
+﻿#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "token_buffer.h"
+#include "symbol_table.h"
+#include "source_buffer.h"
+#include "lexical_analysis.h"
+#include "lexer.h"
+
+/**
+ * 词法分析会话，拥有记号流、标志符表、字符串表、统计结果、词法错误和DFA本身，用于在长期运行的程序中连续分析大量源程序
+ * 每次分析前清空上一次的结果，但保留所有已分配的空间：分析过较大的源程序后，再分析不超过它的源程序时不再有堆分配
+ * （只有词法错误的单词内容仍需分配）
+ * 源程序可以是内存中的内容、文件路径或已打开的文件描述符；分析使用switch实现的DFA，结果与lexical_analysis相同
+ * 词法错误只记录在会话中，不输出；会话不能在线程间共享，每个线程使用自己的会话
+ */
+class lexer_session
+{
+public:
+    lexer_session();
+
+    lexer_session(const lexer_session&) = delete;
+    lexer_session& operator=(const lexer_session&) = delete;
+
+    //分析内存中的源程序，source只需在调用期间有效，之后get_source仍指向它
+    void analyze(std::string_view source);
+
+    //映射（或读入）并分析path，无法打开时返回false，结果为空
+    bool analyze_file(const std::string& path);
+
+    //从fd读到文件结束并分析，读取内容保存在会话的缓冲区中，读取出错时返回false，结果为空；fd由调用者关闭
+    bool analyze_fd(int fd);
+
+    //清空结果并释放映射的文件，保留已分配的空间
+    void reset();
+
+    const token_buffer& get_token_stream() const { return token_stream; }
+    const symbol_table& get_id_list() const { return id_list; }
+    const symbol_table& get_str_list() const { return str_list; }
+    int get_line_num() const { return lex.get_line_num(); }
+    int get_char_num() const { return lex.get_char_num(); }
+    const std::vector<int>& get_word_type_num() const { return lex.get_word_type_num(); }
+    const std::vector<lexical_error>& get_errors() const { return errors; }
+
+    //最近一次分析的源程序，可由记号的偏移和长度取回原文
+    std::string_view get_source() const { return std::string_view(program.data, program.size); }
+
+    //第i个记号的原文
+    std::string_view token_text(size_t i) const { return get_source().substr(token_stream.offset(i), token_stream.length(i)); }
+
+private:
+    void run();
+
+    token_buffer token_stream;
+    symbol_table id_list;
+    symbol_table str_list;
+    std::vector<lexical_error> errors;
+    std::string input;              //从文件描述符读入的内容
+    source_buffer program;
+    lexer<source_buffer> lex;       //引用上面的符号表和program，须在它们之后构造
+};
@@ -4,99 +4,31 @@
 #include <fstream>
 #include <iomanip>
 #include <vector>
+#include <chrono>
+#include <limits>
+#include <cstdlib>
+#include <memory>
+#include "lexical_analysis.h"
+#include "source_buffer.h"
+#include "keyword.h"
+#include "literal.h"
+#include "dfa_table.h"
+#include "simd_scan.h"
+#include "parallel_lexer.h"
+#include "lexer.h"
+#include "line_index.h"
+#include "output_buffer.h"
+#include "lexer_profile.h"
 
 using namespace std;
 
-const vector<string> KEYWORD_LIST = { "auto", "break", "case", "char", "const", "continue", "default", "do", "double",
-"else", "enum", "extern", "float", "for", "goto", "if", "int", "long", "register",
-"return", "short", "signed", "sizeof", "static", "struct", "switch", "typedef", "union", "unsigned",
-"void", "volatile", "while" };
+extern const vector<string> KEYWORD_LIST(begin(KEYWORD_NAMES), end(KEYWORD_NAMES));
 
-const int WORD_TYPE_AMOUNT = 40; // word_type数量，不包含注释和具体的关系运算符和赋值运算符
-enum word_type
-{
-    KEYWORD,                    //关键字
-    ID,                         //标志符
-    STRING,                     //字符串常量
-    CHAR,                       //字符常量
-    INT,                        //整型常量
-    UINT,                       //无符号整型常量
-    LONG,                       //长整型常量
-    ULONG,                      //无符号长整型
-    FLOAT,                      //单精度浮点数
-    DOUBLE,                     //双精度浮点数
-    RELATION_OPERATOR,          //关系运算符
-    ASSIGN_OPERATOR,            //赋值运算符
-    PLUS,                       //"+"
-    MINUS,                      //"-"
-    MULTIPLY,                   //"*"
-    DIVIDE,                     //"/"
-    MOD,                        //"%"
-    INC,                        //"++"
-    DEC,                        //"--"
-    LOGICAL_AND,                //"&&"
-    LOGICAL_OR,                 //"||"
-    LOGICAL_NEGATION,           //"!"
-    BITWISE_AND,                //"&"
-    BITWISE_OR,                 //"|"
-    BITWISE_NEGATION,           //"~"
-    BITWISE_XOR,                //"^"
-    BITWISE_LSHIFT,             //"<<"
-    BITWISE_RSHIFT,             //">>"
-    QUESTION_MARK,              //"?"
-    COLON,                      //":"
-    SEMICOLON,                  //";"
-    LEFT_SQUARE_BRACKET,        //"["
-    RIGHT_SQUARE_BRACKET,       //"]"
-    LEFT_PARENTHESE,            //"("
-    RIGHT_PARENTHESE,           //")"
-    LEFT_BRACE,                 //"{"
-    RIGHT_BRACE,                //"}"
-    DOT,                        //"."
-    COMMA,                      //","
-    ARROW,                      //"->"
-    ANNOTATION,                  //注释
-
-    //关系运算符属性
-    GREATER,                    //">"
-    GREATER_EQUAL,              //">="
-    LESS,                       //"<"
-    LESS_EQUAL,                 //"<="
-    EQUAL,                      //"=="
-    UNEQUAL,                    //"!="
-
-    //赋值运算符属性
-    SIMPLE_EQUAL,               //"="
-    PLUS_EQUAL,                 //"+="
-    MINUS_EQUAL,                //"-="
-    MULTIPLY_EQUAL,             //"*="
-    DIVIDE_EQUAL,               //"/="
-    MOD_EQUAL,                  //"%="
-    AND_EQUAL,                  //"&="
-    OR_EQUAL,                   //"|="
-    XOR_EQUAL,                  //"^="
-    LSHIFT_EQUAL,               //"<<="
-    RSHIFT_EQUAL,               //">>="
-};
-
-union value_type
-{
-    int i;
-    unsigned int ui;
-    long l;
-    unsigned long int ul;
-    unsigned char c;
-    float f;
-    double d;
-};
+thread_local ostream* error_output = &cout;
 
-struct token
-{
-    word_type type;
-    value_type value;
-};
+thread_local vector<lexical_error>* error_log = nullptr;
 
-string to_string(word_type type)
+string_view word_type_name(word_type type)
 {
     switch (type)
     {
@@ -221,155 +153,180 @@ string to_string(word_type type)
     }
 }
 
-inline string to_string(struct token token)
+string to_string(word_type type)
+{
+    return string(word_type_name(type));
+}
+
+string to_string(struct token token)
 {
-    ostringstream ostr;
-    ostr << "<" + to_string((word_type)token.type) + ", ";
-    if (token.type == CHAR)
-        ostr << token.value.c;
-    else if(token.type == INT || token.type == KEYWORD || token.type == ID || token.type == STRING)
-        ostr << token.value.i;
-    else if (token.type == UINT)
-        ostr << token.value.ui;
-    else if (token.type == LONG)
-        ostr << token.value.l;
-    else if (token.type == ULONG)
-        ostr << token.value.ul;
-    else if (token.type == FLOAT)
-        ostr << token.value.f;
-    else if (token.type == DOUBLE)
-        ostr << token.value.d;
-    else if (token.type == RELATION_OPERATOR || token.type == ASSIGN_OPERATOR)
-        ostr << to_string((word_type)token.value.i);
-    ostr << ">";
-    return ostr.str();
+    char text[TOKEN_TEXT_MAX];
+    return string(text, format_token(text, token));
 }
 
-/**
- * 对输入程序进行词法分析，输出对应记号流，统计源程序中的语句行数、各类单词的个数、以及字符总数，同时检查源程序中存在的词法错误，并报告错误所在的位置
- * vector<struct token>& token_stream - 需要返回的记号流
- * vector<string>& id_list - 标志符表
- * vector<string>& str_list - 字符串表
- * int& line_num - 行数
- * vector<int>& word_type_num - 每种单词类型的数量
- * int& char_num - 字符总数
- * ifstream& program - 源程序
- */
-void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_list, vector<string>& str_list, int& line_num, vector<int>& word_type_num, int& char_num, ifstream& program);
+inline bool is_letter(char ch) { return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z'); }
+
+inline bool is_digit(char ch) { return ch >= '0' && ch <= '9'; }
 
-int main()
+inline char get_char(int& char_num, ifstream& program)
 {
+    char_num++;
+    return program.get();
+}
 
-    ifstream program;
-    program.open("program.txt", ios::in);
-    vector<struct token> token_stream;
-    vector<string> id_list;
-    vector<string> str_list;
-    int line_num = 0;
-    int char_num = 0;
-    vector<int> word_type_num(WORD_TYPE_AMOUNT);
+inline void retract(int& char_num, ifstream& program)
+{
+    PROFILE_RETRACT();
+    char_num--;
+    program.unget();
+}
 
-    cout << "Designed by CHEN YU, built: " << __DATE__ << " " <<  __TIME__ << endl;
+inline char get_char(int& char_num, source_buffer& program)
+{
+    char_num++;
+    if (program.pos++ < program.size)
+        return program.data[program.pos - 1];
+    return EOF;
+}
 
-    lexical_analysis(token_stream, id_list, str_list, line_num, word_type_num, char_num, program);
+inline void retract(int& char_num, source_buffer& program)
+{
+    PROFILE_RETRACT();
+    char_num--;
+    program.pos--;
+}
 
-    cout << endl << "keyword list:" << endl;
-    for (int i = 0; i < KEYWORD_LIST.size(); i++) {
-        cout << setiosflags(ios::left) << setw(10) << i << KEYWORD_LIST[i] << endl;
-    }
+//开始识别新单词，逐字符读取时单词内容保存在buf中
+inline void lexeme_begin(string& buf, ifstream&) { buf.clear(); }
 
-    cout << endl << "ID list:" << endl;
-    for (int i = 0; i < id_list.size(); i++) {
-        cout << setiosflags(ios::left) << setw(10) << i << id_list[i] << endl;
-    }
+//开始识别新单词，内存中读取时单词即为data[lexeme_begin, lexeme_end)，无需复制
+inline void lexeme_begin(string&, source_buffer& program) { program.lexeme_begin = program.lexeme_end = program.pos; }
 
-    cout << endl << "string list:" << endl;
-    for (int i = 0; i < str_list.size(); i++) {
-        cout << setiosflags(ios::left) << setw(10) << i << str_list[i] << endl;
-    }
+//将刚读入的字符c加入当前单词
+inline void lexeme_append(string& buf, char c, ifstream&) { buf += c; }
 
-    cout << endl << "token stream:" << endl;
-    for (int i = 0; i < token_stream.size();) {
-        for(int j = 0; j < 10 && i < token_stream.size(); j++, i++)
-            cout << setiosflags(ios::left) << setw(11) << to_string(token_stream[i]) << " ";
-        cout << endl;
-    }
+inline void lexeme_append(string&, char, source_buffer& program) { program.lexeme_end = program.pos; }
 
-    cout << endl << "word type num:" << endl;
-    for (int i = 0; i < word_type_num.size(); i++)
-    {
-        cout << setiosflags(ios::left) << setw(14) << to_string((word_type)i) << word_type_num[i] << endl;
-    }
+//当前单词的内容
+inline string_view lexeme(const string& buf, const ifstream&) { return buf; }
 
-    cout << "char num: " << char_num << endl;
+inline string_view lexeme(const string&, const source_buffer& program) { return string_view(program.data + program.lexeme_begin, program.lexeme_end - program.lexeme_begin); }
 
-    cout << "line num: " << line_num << endl;
+//跳过连续的空白字符，逐字符读取时不做处理，由状态0逐个跳过
+inline void skip_blank(int&, int&, ifstream&) {}
 
-    return 0;
+inline void skip_blank(int& char_num, int& line_num, source_buffer& program)
+{
+    if (program.pos >= program.size)
+        return;
+    int newlines = 0;
+    size_t n = scan->skip_blank(program.data + program.pos, program.size - program.pos, newlines);
+    PROFILE_SCANNED(n);
+    program.pos += n;
+    char_num += n;
+    line_num += newlines;
 }
 
-inline bool is_letter(char ch) { return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z'); }
+//将紧接着的标志符字符全部加入当前单词
+inline void skip_identifier(int&, string&, ifstream&) {}
 
-inline bool is_digit(char ch) { return ch >= '0' && ch <= '9'; }
-
-inline char get_char(int& char_num, ifstream& program)
+inline void skip_identifier(int& char_num, string&, source_buffer& program)
 {
-    char_num++;
-    return program.get();
+    if (program.pos >= program.size)
+        return;
+    size_t n = scan->skip_identifier(program.data + program.pos, program.size - program.pos);
+    PROFILE_SCANNED(n);
+    program.pos += n;
+    char_num += n;
+    program.lexeme_end = program.pos;
 }
 
-inline void retract(int& char_num, ifstream& program)
+//跳到单行注释末尾的换行之前
+inline void skip_line_comment(int&, ifstream&) {}
+
+inline void skip_line_comment(int& char_num, source_buffer& program)
 {
-    char_num--;
-    program.unget();
+    if (program.pos >= program.size)
+        return;
+    size_t n = scan->find_line_end(program.data + program.pos, program.size - program.pos);
+    PROFILE_SCANNED(n);
+    program.pos += n;
+    char_num += n;
 }
 
-inline void error(const string& str, const int& line_num)
+//跳到多行注释中下一个'*'之前
+inline void skip_block_comment(int&, int&, ifstream&) {}
+
+inline void skip_block_comment(int& char_num, int& line_num, source_buffer& program)
 {
-    cout << "error " << line_num + 1 << ": " << str << endl;
+    if (program.pos >= program.size)
+        return;
+    int newlines = 0;
+    size_t n = scan->find_comment_star(program.data + program.pos, program.size - program.pos, newlines);
+    PROFILE_SCANNED(n);
+    program.pos += n;
+    char_num += n;
+    line_num += newlines;
 }
 
-//二分搜索str在KEYWORD_LIST的位置，若搜索到返回位置，否者返回-1
-int reserve(const string& str)
+//分块分析时在状态0开始识别新单词前调用，推测分析按间隔记录同步点，重新分析到达推测分析的同步点时返回true
+inline bool chunk_boundary(chunk_control&, size_t, const ifstream&) { return false; }
+
+inline bool chunk_boundary(chunk_control& control, size_t token_num, const source_buffer& program)
 {
-    int high = KEYWORD_LIST.size() - 1;
-    int low = 0;
-    int middle = (high + low) / 2;
-    while (high >= low)
+    if (control.sync_points == nullptr)
     {
-        middle = (high + low) / 2;
-        if (KEYWORD_LIST[middle].compare(str) == 0)
-            return middle;
-        else if (KEYWORD_LIST[middle].compare(str) < 0)
+        if (token_num >= control.next_checkpoint)
         {
-            low = middle + 1;
-        }
-        else
-        {
-            high = middle - 1;
+            control.checkpoints.push_back({ program.pos, token_num, (size_t)error_output->tellp() });
+            control.next_checkpoint = token_num + CHUNK_CHECKPOINT_INTERVAL;
         }
+        return false;
     }
-    return -1;
+    const vector<chunk_checkpoint>& points = *control.sync_points;
+    while (control.next_sync < points.size() && points[control.next_sync].pos < program.pos)
+        control.next_sync++;
+    control.synced = control.next_sync < points.size() && points[control.next_sync].pos == program.pos;
+    return control.synced;
 }
 
-//搜索str在table的位置，若搜索到返回位置，否者插入到表格末尾
-int table_insert(vector<string>& table, const string& str)
+void error(string_view str, size_t offset)
 {
-    for (int i = 0; i < table.size(); i++)
+    if (error_log)
+        error_log->push_back({ offset, string(str) });
+    if (!error_output)
+        return;
+    if (error_lines)
     {
-        if (table[i].compare(str) == 0)
-            return i;
+        source_location location = error_lines->locate(offset);
+        *error_output << error_lines->get_path() << ":" << location.line << ":" << location.column << ": error: " << str << endl;
     }
-    table.push_back(str);
-    return table.size() - 1;
+    else
+        *error_output << "offset " << offset << ": error: " << str << endl;
+}
+
+//使用完美哈希查找str在KEYWORD_LIST的位置，若搜索到返回位置，否者返回-1
+inline int reserve(string_view str)
+{
+    PROFILE_SCOPE(reserve);
+    return keyword_lookup(str);
+}
+
+//搜索str在table的位置，若搜索到返回位置，否者插入到表格末尾
+inline int table_insert(symbol_table& table, string_view str)
+{
+    PROFILE_SCOPE(table_insert);
+    return table.insert(str);
 }
 
 //将分析出的记号加入记号流
-void word_analysis(vector<struct token>& token_stream, vector<string>& id_list, vector<string>& str_list, vector<int>& word_type_num,
-    const int& line_num, const word_type& type, const string& buf = "", const int& num_base = 10)
+void word_analysis(vector<struct token>& token_stream, symbol_table& id_list, symbol_table& str_list, vector<int>& word_type_num,
+    size_t offset, const word_type& type, string_view buf)
 {
+    PROFILE_SCOPE(word_analysis);
     struct token token;
     token.type = type;
+    integer_literal number;
     switch (type)
     {
         int is_kw;
@@ -379,6 +336,7 @@ void word_analysis(vector<struct token>& token_stream, vector<string>& id_list,
         if (is_kw != -1)
         {
             token = { KEYWORD, is_kw };
+            id_list.add_keyword_count(is_kw);
         }
         else
         {
@@ -387,11 +345,11 @@ void word_analysis(vector<struct token>& token_stream, vector<string>& id_list,
         }
         break;
     case CHAR:
-        if (buf[0] == '\\')
+        if (!buf.empty() && buf[0] == '\\')
         {
             if (buf.length() <= 1)
             {
-                error(buf, line_num);
+                error(buf, offset);
                 return;
             }
             switch (buf[1])
@@ -406,84 +364,167 @@ void word_analysis(vector<struct token>& token_stream, vector<string>& id_list,
             case '\"':  token.value.c = '\"';   break;
             case '0':   token.value.c = '\0';   break;
             case 'x':
-                if (buf.length() >= 2 && (is_digit(buf[2]) || (buf[2] >= 'a' && buf[2] <= 'f') || (buf[2] >= 'A' && buf[2] <= 'F')))
+                if (parse_integer(buf.substr(2), 16, number) > 0)
                 {
-                    int temp = stoi(buf.substr(2), 0, 16);
-                    if (temp > 0xff)
+                    if (number.overflow || number.value > 0xff)
                     {
-                        error(buf, line_num);
+                        error(buf, offset);
                         return;
                     }
-                    token.value.c = stoi(buf.substr(2), 0, 16);
+                    token.value.c = number.value;
                 }
                 else
                 {
-                    error(buf, line_num);
+                    error(buf, offset);
                     return;
                 }
                 break;
             case '1':   case '2':   case '3':   case '4':
             case '5':   case '6':   case '7':
-            {
-                token.value.c = stoi(buf.substr(1), 0, 8);
-                if (token.value.c > 0xff)
+                parse_integer(buf.substr(1), 8, number);
+                if (number.overflow || number.value > 0xff)
                 {
-                    error(buf, line_num);
+                    error(buf, offset);
                     return;
                 }
-            }
-            break;
+                token.value.c = number.value;
+                break;
             default:
                 token.value.c = buf[1];
             }
         }
-        else
+        else if (!buf.empty())
             token.value.c = buf[0];
-        break;
-    case INT:
-        token.value.i = stoi(buf, 0, num_base);
-        break;
-    case UINT:
-        token.value.ui = stoul(buf, 0, num_base);
-        break;
-    case LONG:
-        token.value.l = stol(buf, 0, num_base);
-        break;
-    case ULONG:
-        token.value.ul = stoul(buf, 0, num_base);
+        else
+            token.value.c = '\0'; //空字符常量
         break;
     case FLOAT:
-        token.value.f = stof(buf);
+        if (!parse_real(buf, token.value.f))
+        {
+            error(buf, offset);
+            return;
+        }
         break;
     case DOUBLE:
-        token.value.d = stod(buf);
+        if (!parse_real(buf, token.value.d))
+        {
+            error(buf, offset);
+            return;
+        }
         break;
     case STRING:
         str_entry = table_insert(str_list, buf);
         token.value.i = str_entry;
         break;
-    case RELATION_OPERATOR: case ASSIGN_OPERATOR:
-        token.value.i = stoi(buf);
+    default:
+        break;
+    }
+    word_type_num[token.type]++;
+    token_stream.push_back(token);
+}
+
+//将整型常量记号加入记号流，number为DFA扫描时累加得到的值，超出type的表示范围时报错
+void number_analysis(vector<struct token>& token_stream, vector<int>& word_type_num, size_t offset, const word_type& type, string_view buf, const integer_literal& number)
+{
+    struct token token;
+    token.type = type;
+    bool overflow = number.overflow;
+    switch (type)
+    {
+    case INT:
+        overflow = overflow || number.value > (unsigned long long)numeric_limits<int>::max();
+        token.value.i = (int)number.value;
+        break;
+    case UINT:
+        overflow = overflow || number.value > numeric_limits<unsigned int>::max();
+        token.value.ui = (unsigned int)number.value;
+        break;
+    case LONG:
+        overflow = overflow || number.value > (unsigned long long)numeric_limits<long>::max();
+        token.value.l = (long)number.value;
+        break;
+    case ULONG:
+        overflow = overflow || number.value > numeric_limits<unsigned long>::max();
+        token.value.ul = (unsigned long)number.value;
         break;
     default:
         break;
     }
+    if (overflow)
+    {
+        error(buf, offset);
+        return;
+    }
     word_type_num[token.type]++;
     token_stream.push_back(token);
 }
 
-void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_list, vector<string>& str_list, int& line_num, vector<int>& word_type_num, int& char_num, ifstream& program)
+//将关系运算符或赋值运算符记号加入记号流，attribute为具体的运算符，直接作为记号的属性
+inline void operator_analysis(vector<struct token>& token_stream, vector<int>& word_type_num, const word_type& type, const word_type& attribute)
 {
-    int state = 0;
-    char c;
-    char last_char;
-    string buf;
+    word_type_num[type]++;
+    token_stream.push_back({ type, { attribute } });
+}
+
+template <class Source>
+lexer<Source>::lexer(symbol_table& id_list, symbol_table& str_list, Source& program, int char_num, int state, chunk_control* control)
+    : id_list(id_list), str_list(str_list), program(program), control(control), state(state), char_num(char_num), word_type_num(WORD_TYPE_AMOUNT)
+{
+    if (control)
+        lexeme_offset = control->entry_offset;
+}
+
+template <class Source>
+void lexer<Source>::reset(int char_num, int state)
+{
+    this->state = state;
+    this->char_num = char_num;
+    c = 0;
+    last_char = 0;
+    buf.clear();
+    literal_clear(number);
+    finished = false;
+    line_num = 0;
+    word_type_num.assign(WORD_TYPE_AMOUNT, 0);
+    token_num = 0;
+    lexeme_offset = 0;
+    token_offset = 0;
+    token_length = 0;
+    token_stream.clear();
+    next_pending = 0;
+}
+
+template <class Source>
+bool lexer<Source>::next_token(struct token& token)
+{
+    if (finished)
+        return false;
     while (true)
     {
+        PROFILE_SWITCH_STEP(state, c);
         switch (state)
         {
         case 0:
-            buf = "";
+            //每个记号识别完都会回到状态0，此时交给调用者
+            if (next_pending < token_stream.size())
+            {
+                token = token_stream[next_pending++];
+                token_num++;
+                token_offset = lexeme_offset;
+                token_length = char_num - lexeme_offset;
+                return true;
+            }
+            token_stream.clear();
+            next_pending = 0;
+            if (control && chunk_boundary(*control, token_num, program))
+            {
+                finished = true;
+                return false;
+            }
+            skip_blank(char_num, line_num, program);
+            lexeme_begin(buf, program);
+            lexeme_offset = char_num;
+            literal_clear(number);
             c = get_char(char_num, program);
 
             if (is_letter(c) || c == '_')
@@ -514,41 +555,44 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
             case '|':   state = 27; break;
             case '^':   state = 28; break;
             case '.':   state = 29; break;
-            case '~':   word_analysis(token_stream, id_list, str_list, word_type_num, line_num, BITWISE_NEGATION);    break;
-            case '?':   word_analysis(token_stream, id_list, str_list, word_type_num, line_num, QUESTION_MARK);    break;
-            case ':':   word_analysis(token_stream, id_list, str_list, word_type_num, line_num, COLON);    break;
-            case ';':   word_analysis(token_stream, id_list, str_list, word_type_num, line_num, SEMICOLON);    break;
-            case '[':   word_analysis(token_stream, id_list, str_list, word_type_num, line_num, LEFT_SQUARE_BRACKET);    break;
-            case ']':   word_analysis(token_stream, id_list, str_list, word_type_num, line_num, RIGHT_SQUARE_BRACKET);    break;
-            case '(':   word_analysis(token_stream, id_list, str_list, word_type_num, line_num, LEFT_PARENTHESE);    break;
-            case ')':   word_analysis(token_stream, id_list, str_list, word_type_num, line_num, RIGHT_PARENTHESE);    break;
-            case '{':   word_analysis(token_stream, id_list, str_list, word_type_num, line_num, LEFT_BRACE);    break;
-            case '}':   word_analysis(token_stream, id_list, str_list, word_type_num, line_num, RIGHT_BRACE);    break;
-            case ',':   word_analysis(token_stream, id_list, str_list, word_type_num, line_num, COMMA);    break;
+            case '~':   word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, BITWISE_NEGATION);    break;
+            case '?':   word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, QUESTION_MARK);    break;
+            case ':':   word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, COLON);    break;
+            case ';':   word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, SEMICOLON);    break;
+            case '[':   word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, LEFT_SQUARE_BRACKET);    break;
+            case ']':   word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, RIGHT_SQUARE_BRACKET);    break;
+            case '(':   word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, LEFT_PARENTHESE);    break;
+            case ')':   word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, RIGHT_PARENTHESE);    break;
+            case '{':   word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, LEFT_BRACE);    break;
+            case '}':   word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, RIGHT_BRACE);    break;
+            case ',':   word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, COMMA);    break;
             case ' ':   case '\t':  break;
             case '\n':  line_num++; break;
             case EOF:   
                 line_num++; //加上最后一行
                 char_num--; //减去文件结束符EOF
-                return;
+                finished = true;
+                return false;
             default:
-                error(buf, line_num);
+                error(lexeme(buf, program), lexeme_offset);
             }
             break;
         case 1: //标志符状态
-            buf += c;
+            lexeme_append(buf, c, program);
+            skip_identifier(char_num, buf, program);
             c = get_char(char_num, program);
             if (is_letter(c) || is_digit(c) || c == '_' || c == '$') // 标志符由数字、字母、下划线_、美元符号$组成
                 state = 1;
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ID, buf);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, ID, lexeme(buf, program));
                 state = 0;
             }
             break;
         case 2: //常数状态
-            buf += c;
+            lexeme_append(buf, c, program);
+            literal_push(number, c, 10);
             c = get_char(char_num, program);
             if (is_digit(c))
                 state = 2;
@@ -561,13 +605,13 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
                 c = get_char(char_num, program);
                 if (c == 'l' || c == 'L')
                 {
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ULONG, buf);
+                    number_analysis(token_stream, word_type_num, lexeme_offset, ULONG, lexeme(buf, program), number);
                     state = 0;
                 }
                 else
                 {
                     retract(char_num, program);
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, UINT, buf);
+                    number_analysis(token_stream, word_type_num, lexeme_offset, UINT, lexeme(buf, program), number);
                     state = 0;
                 }
             }
@@ -576,25 +620,26 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
                 c = get_char(char_num, program);
                 if (c == 'u' || c == 'U')
                 {
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ULONG, buf);
+                    number_analysis(token_stream, word_type_num, lexeme_offset, ULONG, lexeme(buf, program), number);
                     state = 0;
                 }
                 else
                 {
                     retract(char_num, program);
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, LONG, buf);
+                    number_analysis(token_stream, word_type_num, lexeme_offset, LONG, lexeme(buf, program), number);
                     state = 0;
                 }
             }
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, INT, buf);
+                number_analysis(token_stream, word_type_num, lexeme_offset, INT, lexeme(buf, program), number);
                 state = 0;
             }
             break;
         case 3: //0开头状态
-            buf += c;
+            lexeme_append(buf, c, program);
+            literal_push(number, c, 8);
             c = get_char(char_num, program);
             if (c <= '7' && c >= '0')
                 state = 4;
@@ -611,13 +656,13 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
                 c = get_char(char_num, program);
                 if (c == 'l' || c == 'L')
                 {
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ULONG, buf);
+                    number_analysis(token_stream, word_type_num, lexeme_offset, ULONG, lexeme(buf, program), number);
                     state = 0;
                 }
                 else
                 {
                     retract(char_num, program);
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, UINT, buf);
+                    number_analysis(token_stream, word_type_num, lexeme_offset, UINT, lexeme(buf, program), number);
                     state = 0;
                 }
             }
@@ -626,25 +671,26 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
                 c = get_char(char_num, program);
                 if (c == 'u' || c == 'U')
                 {
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ULONG, buf);
+                    number_analysis(token_stream, word_type_num, lexeme_offset, ULONG, lexeme(buf, program), number);
                     state = 0;
                 }
                 else
                 {
                     retract(char_num, program);
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, LONG, buf);
+                    number_analysis(token_stream, word_type_num, lexeme_offset, LONG, lexeme(buf, program), number);
                     state = 0;
                 }
             }
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, INT, buf);
+                number_analysis(token_stream, word_type_num, lexeme_offset, INT, lexeme(buf, program), number);
                 state = 0;
             }
             break;
         case 4: //八进制数
-            buf += c;
+            lexeme_append(buf, c, program);
+            literal_push(number, c, 8);
             c = get_char(char_num, program);
             if (c <= '7' && c >= '0')
                 state = 4;
@@ -659,13 +705,13 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
                 c = get_char(char_num, program);
                 if (c == 'l' || c == 'L')
                 {
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ULONG, buf, 8);
+                    number_analysis(token_stream, word_type_num, lexeme_offset, ULONG, lexeme(buf, program), number);
                     state = 0;
                 }
                 else
                 {
                     retract(char_num, program);
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, UINT, buf, 8);
+                    number_analysis(token_stream, word_type_num, lexeme_offset, UINT, lexeme(buf, program), number);
                     state = 0;
                 }
             }
@@ -674,37 +720,38 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
                 c = get_char(char_num, program);
                 if (c == 'u' || c == 'U')
                 {
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ULONG, buf, 8);
+                    number_analysis(token_stream, word_type_num, lexeme_offset, ULONG, lexeme(buf, program), number);
                     state = 0;
                 }
                 else
                 {
                     retract(char_num, program);
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, LONG, buf, 8);
+                    number_analysis(token_stream, word_type_num, lexeme_offset, LONG, lexeme(buf, program), number);
                     state = 0;
                 }
             }
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, INT, buf, 8);
+                number_analysis(token_stream, word_type_num, lexeme_offset, INT, lexeme(buf, program), number);
                 state = 0;
             }
             break;
         case 5: //十六进制数
-            buf += c;
+            lexeme_append(buf, c, program);
             c = get_char(char_num, program);
             if (is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))
                 state = 6;
             else
             {
                 retract(char_num, program);
-                error(buf, line_num);
+                error(lexeme(buf, program), lexeme_offset);
                 state = 0;
             }
             break;
         case 6:
-            buf += c;
+            lexeme_append(buf, c, program);
+            literal_push(number, c, 16);
             c = get_char(char_num, program);
             if (is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))
                 state = 6;
@@ -713,13 +760,13 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
                 c = get_char(char_num, program);
                 if (c == 'l' || c == 'L')
                 {
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ULONG, buf, 16);
+                    number_analysis(token_stream, word_type_num, lexeme_offset, ULONG, lexeme(buf, program), number);
                     state = 0;
                 }
                 else
                 {
                     retract(char_num, program);
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, UINT, buf, 16);
+                    number_analysis(token_stream, word_type_num, lexeme_offset, UINT, lexeme(buf, program), number);
                     state = 0;
                 }
             }
@@ -728,25 +775,25 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
                 c = get_char(char_num, program);
                 if (c == 'u' || c == 'U')
                 {
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ULONG, buf, 16);
+                    number_analysis(token_stream, word_type_num, lexeme_offset, ULONG, lexeme(buf, program), number);
                     state = 0;
                 }
                 else
                 {
                     retract(char_num, program);
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, LONG, buf, 16);
+                    number_analysis(token_stream, word_type_num, lexeme_offset, LONG, lexeme(buf, program), number);
                     state = 0;
                 }
             }
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, INT, buf, 16);
+                number_analysis(token_stream, word_type_num, lexeme_offset, INT, lexeme(buf, program), number);
                 state = 0;
             }
             break;
         case 7: //实型状态
-            buf += c;
+            lexeme_append(buf, c, program);
             c = get_char(char_num, program);
             if (c > '7' && c <= '9')
                 state = 7;
@@ -757,12 +804,12 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
             else
             {
                 retract(char_num, program);
-                error(buf, line_num);
+                error(lexeme(buf, program), lexeme_offset);
                 state = 0;
             }
             break;
         case 8: //小数状态
-            buf += c;
+            lexeme_append(buf, c, program);
             c = get_char(char_num, program);
             if (is_digit(c))
                 state = 8;
@@ -770,23 +817,23 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
                 state = 9;
             else if (c == 'f' || c == 'F')
             {
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, FLOAT, buf);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, FLOAT, lexeme(buf, program));
                 state = 0;
             }
             else if (c == 'l' || c == 'L')
             {
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, DOUBLE, buf);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, DOUBLE, lexeme(buf, program));
                 state = 0;
             }
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, FLOAT, buf);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, FLOAT, lexeme(buf, program));
                 state = 0;
             }
             break;
         case 9: //指数状态
-            buf += c;
+            lexeme_append(buf, c, program);
             c = get_char(char_num, program);
             if (is_digit(c))
                 state = 11;
@@ -795,46 +842,46 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
             else
             {
                 retract(char_num, program);
-                error(buf, line_num);
+                error(lexeme(buf, program), lexeme_offset);
                 state = 0;
             }
             break;
         case 10:
-            buf += c;
+            lexeme_append(buf, c, program);
             c = get_char(char_num, program);
             if (is_digit(c))
                 state = 11;
             else
             {
                 retract(char_num, program);
-                error(buf, line_num);
+                error(lexeme(buf, program), lexeme_offset);
                 state = 0;
             }
             break;
         case 11:
-            buf += c;
+            lexeme_append(buf, c, program);
             c = get_char(char_num, program);
             if (is_digit(c))
                 state = 11;
             else if (c == 'f' || c == 'F')
             {
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, FLOAT, buf);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, FLOAT, lexeme(buf, program));
                 state = 0;
             }
             else if (c == 'l' || c == 'L')
             {
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, DOUBLE, buf);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, DOUBLE, lexeme(buf, program));
                 state = 0;
             }
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, FLOAT, buf);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, FLOAT, lexeme(buf, program));
                 state = 0;
             }
             break;
         case 12: //字符常量
-            buf += c;
+            lexeme_append(buf, c, program);
             last_char = c;
             c = get_char(char_num, program);
             if (c == '\'')
@@ -843,8 +890,7 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
                     state = 12;
                 else
                 {
-                    buf.erase(0, 1);
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, CHAR, buf);
+                    word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, CHAR, lexeme(buf, program).substr(1));
                     state = 0;
                 }
 
@@ -852,14 +898,14 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
             else if (c == EOF || c == '\n')
             {
                 retract(char_num, program);
-                error(buf, line_num);
+                error(lexeme(buf, program), lexeme_offset);
                 state = 0;
             }
             else
                 state = 12;
             break;
         case 13: // 字符串常量
-            buf += c;
+            lexeme_append(buf, c, program);
             last_char = c;
             c = get_char(char_num, program);
             if (c == '\"')
@@ -868,15 +914,14 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
                     state = 13;
                 else
                 {
-                    buf.erase(0, 1);
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, STRING, buf);
+                    word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, STRING, lexeme(buf, program).substr(1));
                     state = 0;
                 }
             }
             else if (c == EOF || c == '\n')
             {
                 retract(char_num, program);
-                error(buf, line_num);
+                error(lexeme(buf, program), lexeme_offset);
                 state = 0;
             }
             else
@@ -885,105 +930,105 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
         case 14: //'<'状态
             c = get_char(char_num, program); 
             if (c == '=')
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, RELATION_OPERATOR, to_string((int)LESS_EQUAL));
+                operator_analysis(token_stream, word_type_num, RELATION_OPERATOR, LESS_EQUAL);
             else if (c == '<')
             {
                 c = get_char(char_num, program);
                 if (c == '=')
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ASSIGN_OPERATOR, to_string((int)LSHIFT_EQUAL));
+                    operator_analysis(token_stream, word_type_num, ASSIGN_OPERATOR, LSHIFT_EQUAL);
                 else
                 {
                     retract(char_num, program);
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, BITWISE_LSHIFT);
+                    word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, BITWISE_LSHIFT);
                 }
             }
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, RELATION_OPERATOR, to_string((int)LESS));
+                operator_analysis(token_stream, word_type_num, RELATION_OPERATOR, LESS);
             }
             state = 0;
             break;
         case 15: //">"状态
             c = get_char(char_num, program);
             if (c == '=')
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, RELATION_OPERATOR, to_string((int)GREATER_EQUAL));
+                operator_analysis(token_stream, word_type_num, RELATION_OPERATOR, GREATER_EQUAL);
             else if (c == '>')
             {
                 c = get_char(char_num, program);
                 if (c == '=')
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ASSIGN_OPERATOR, to_string((int)RSHIFT_EQUAL));
+                    operator_analysis(token_stream, word_type_num, ASSIGN_OPERATOR, RSHIFT_EQUAL);
                 else
                 {
                     retract(char_num, program);
-                    word_analysis(token_stream, id_list, str_list, word_type_num, line_num, BITWISE_RSHIFT);
+                    word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, BITWISE_RSHIFT);
                 }
             }
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, RELATION_OPERATOR, to_string((int)GREATER));
+                operator_analysis(token_stream, word_type_num, RELATION_OPERATOR, GREATER);
             }
             state = 0;
             break;
         case 16: //'='状态
             c = get_char(char_num, program);
             if (c == '=')
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, RELATION_OPERATOR, to_string((int)EQUAL));
+                operator_analysis(token_stream, word_type_num, RELATION_OPERATOR, EQUAL);
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ASSIGN_OPERATOR, to_string((int)SIMPLE_EQUAL));
+                operator_analysis(token_stream, word_type_num, ASSIGN_OPERATOR, SIMPLE_EQUAL);
             }
             state = 0;
             break;
         case 17: //'!'状态
             c = get_char(char_num, program);
             if (c == '=')
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, RELATION_OPERATOR, to_string((int)UNEQUAL));
+                operator_analysis(token_stream, word_type_num, RELATION_OPERATOR, UNEQUAL);
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, LOGICAL_NEGATION);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, LOGICAL_NEGATION);
             }
             state = 0;
             break;
         case 18: //'+'状态
             c = get_char(char_num, program);
             if (c == '=')
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ASSIGN_OPERATOR, to_string((int)PLUS_EQUAL));
+                operator_analysis(token_stream, word_type_num, ASSIGN_OPERATOR, PLUS_EQUAL);
             else if (c == '+')
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, INC);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, INC);
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, PLUS);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, PLUS);
             }
             state = 0;
             break;
         case 19: //'-'状态
             c = get_char(char_num, program);
             if (c == '=')
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ASSIGN_OPERATOR, to_string((int)MINUS_EQUAL));
+                operator_analysis(token_stream, word_type_num, ASSIGN_OPERATOR, MINUS_EQUAL);
             else if (c == '-')
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, DEC);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, DEC);
             else if (c == '>')
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ARROW);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, ARROW);
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, MINUS);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, MINUS);
             }
             state = 0;
             break;
         case 20: //'*'状态
             c = get_char(char_num, program);
             if (c == '=')
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ASSIGN_OPERATOR, to_string((int)MULTIPLY_EQUAL));
+                operator_analysis(token_stream, word_type_num, ASSIGN_OPERATOR, MULTIPLY_EQUAL);
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, MULTIPLY);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, MULTIPLY);
             }
             state = 0;
             break;
@@ -991,7 +1036,7 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
             c = get_char(char_num, program);
             if (c == '=')
             {
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ASSIGN_OPERATOR, to_string((int)DIVIDE_EQUAL));
+                operator_analysis(token_stream, word_type_num, ASSIGN_OPERATOR, DIVIDE_EQUAL);
                 state = 0;
             }
             else if (c == '/') //单行注释
@@ -1001,11 +1046,12 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, DIVIDE);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, DIVIDE);
                 state = 0;
             }
             break;
         case 22: //单行注释
+            skip_line_comment(char_num, program);
             c = get_char(char_num, program);
             if (c == EOF || c == '\n')
             {
@@ -1016,11 +1062,19 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
                 state = 22;
             break;
         case 23: //多行注释
+            skip_block_comment(char_num, line_num, program);
             c = get_char(char_num, program);
             if (c == EOF)
             {
                 retract(char_num, program);
-                error(buf, line_num);
+                if (control && !control->last_chunk) //注释延续到下一分块
+                {
+                    control->exit_state = 23;
+                    control->exit_offset = lexeme_offset;
+                    finished = true;
+                    return false;
+                }
+                error(lexeme(buf, program), lexeme_offset);
                 state = 0;
             }
             else if (c == '\n')
@@ -1035,7 +1089,14 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
             if (c == EOF)
             {
                 retract(char_num, program);
-                error(buf, line_num);
+                if (control && !control->last_chunk) //注释延续到下一分块
+                {
+                    control->exit_state = 24;
+                    control->exit_offset = lexeme_offset;
+                    finished = true;
+                    return false;
+                }
+                error(lexeme(buf, program), lexeme_offset);
                 state = 0;
             }
             else if (c == '\n')
@@ -1048,66 +1109,263 @@ void lexical_analysis(vector<struct token>& token_stream, vector<string>& id_lis
                 state = 23;
             break;
         case 25: //'%'状态
+            c = get_char(char_num, program);
             if (c == '=')
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ASSIGN_OPERATOR, to_string((int)MOD_EQUAL));
+                operator_analysis(token_stream, word_type_num, ASSIGN_OPERATOR, MOD_EQUAL);
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, MOD);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, MOD);
             }
             state = 0;
             break;
         case 26: //'&'状态
             c = get_char(char_num, program);
             if (c == '=')
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ASSIGN_OPERATOR, to_string((int)AND_EQUAL));
+                operator_analysis(token_stream, word_type_num, ASSIGN_OPERATOR, AND_EQUAL);
             else if (c == '&')
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, LOGICAL_AND);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, LOGICAL_AND);
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, BITWISE_AND);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, BITWISE_AND);
             }
             state = 0;
             break;
         case 27: //'|'状态
             c = get_char(char_num, program);
             if (c == '=')
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ASSIGN_OPERATOR, to_string((int)OR_EQUAL));
+                operator_analysis(token_stream, word_type_num, ASSIGN_OPERATOR, OR_EQUAL);
             else if (c == '|')
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, LOGICAL_OR);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, LOGICAL_OR);
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, BITWISE_OR);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, BITWISE_OR);
             }
             state = 0;
             break;
         case 28: //'^'状态
             c = get_char(char_num, program);
             if (c == '=')
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, ASSIGN_OPERATOR, to_string((int)XOR_EQUAL));
+                operator_analysis(token_stream, word_type_num, ASSIGN_OPERATOR, XOR_EQUAL);
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, BITWISE_XOR);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, BITWISE_XOR);
             }
             state = 0;
             break;
         case 29: //'.'状态
             c = get_char(char_num, program);
-            if (is_digit(c)) //小数
+            if (is_digit(c)) //小数，回退到'.'以便将其加入单词
+            {
+                retract(char_num, program);
+                c = '.';
                 state = 8;
+            }
             else
             {
                 retract(char_num, program);
-                word_analysis(token_stream, id_list, str_list, word_type_num, line_num, DOT);
+                word_analysis(token_stream, id_list, str_list, word_type_num, lexeme_offset, DOT);
                 state = 0;
             }
             break;
         default:
-            error(buf, line_num);
+            error(lexeme(buf, program), lexeme_offset);
             break;
         }     
     }
-}
\ No newline at end of file
+}
+
+template <class Source>
+void lexical_analysis(token_buffer& token_stream, symbol_table& id_list, symbol_table& str_list, int& line_num, vector<int>& word_type_num, int& char_num, Source& program)
+{
+    lexer<Source> lex(id_list, str_list, program);
+    struct token token;
+    while (lex.next_token(token))
+        token_stream.push_back(token, lex.get_token_offset(), lex.get_token_length());
+    line_num += lex.get_line_num();
+    char_num += lex.get_char_num();
+    for (int i = 0; i < WORD_TYPE_AMOUNT; i++)
+        word_type_num[i] += lex.get_word_type_num()[i];
+}
+
+template <class Source>
+void table_lexical_analysis(token_buffer& token_stream, symbol_table& id_list, symbol_table& str_list, int& line_num, vector<int>& word_type_num, int& char_num, Source& program)
+{
+    int state = DFA_START;
+    string buf;
+    integer_literal number;
+    vector<struct token> emitted;   //本次转移识别出的记号
+    int char_start = char_num;
+    int token_begin = char_num;     //当前单词开始时的char_num
+    lexeme_begin(buf, program);
+    literal_clear(number);
+    while (true)
+    {
+        char c = get_char(char_num, program);
+        const dfa_entry& entry = DFA_TABLE.entry[state][DFA_TABLE.char_class[(unsigned char)c]];
+        PROFILE_TABLE_STEP(state, DFA_TABLE.char_class[(unsigned char)c]);
+        //绝大多数字符只需加入当前单词或直接跳过
+        if (entry.action & DFA_SIMPLE)
+        {
+            if (entry.action & DFA_APPEND)
+                lexeme_append(buf, c, program);
+            state = entry.next;
+            continue;
+        }
+        if (entry.action & DFA_APPEND)
+        {
+            lexeme_append(buf, c, program);
+            if (DFA_TABLE.push_base[entry.next])
+                literal_push(number, c, DFA_TABLE.push_base[entry.next]);
+        }
+        if (entry.action & DFA_RETRACT)
+            retract(char_num, program);
+        if (entry.action & DFA_NEWLINE)
+            line_num++;
+        switch (entry.emit)
+        {
+        case EMIT_NONE:
+            break;
+        case EMIT_WORD:
+            word_analysis(emitted, id_list, str_list, word_type_num, token_begin - char_start, (word_type)entry.type);
+            break;
+        case EMIT_PUNCTUATION:
+            word_analysis(emitted, id_list, str_list, word_type_num, token_begin - char_start, DFA_TABLE.punctuation[(unsigned char)c]);
+            break;
+        case EMIT_LEXEME:
+            word_analysis(emitted, id_list, str_list, word_type_num, token_begin - char_start, (word_type)entry.type, lexeme(buf, program));
+            break;
+        case EMIT_QUOTED:
+            word_analysis(emitted, id_list, str_list, word_type_num, token_begin - char_start, (word_type)entry.type, lexeme(buf, program).substr(1));
+            break;
+        case EMIT_NUMBER:
+            number_analysis(emitted, word_type_num, token_begin - char_start, (word_type)entry.type, lexeme(buf, program), number);
+            break;
+        case EMIT_OPERATOR:
+            operator_analysis(emitted, word_type_num, (word_type)entry.type, (word_type)entry.attribute);
+            break;
+        case EMIT_ERROR:
+            error(lexeme(buf, program), token_begin - char_start);
+            break;
+        case EMIT_END:
+            line_num++; //加上最后一行
+            char_num--; //减去文件结束符EOF
+            return;
+        }
+        if (!emitted.empty())
+        {
+            token_stream.push_back(emitted[0], token_begin - char_start, char_num - token_begin);
+            emitted.clear();
+        }
+        if (entry.action & DFA_BEGIN)
+        {
+            token_begin = char_num;
+            lexeme_begin(buf, program);
+            literal_clear(number);
+        }
+        state = entry.next;
+    }
+}
+
+//一次分析的全部结果，用于比较两种实现
+struct analysis_result
+{
+    token_buffer token_stream;
+    symbol_table id_list;
+    symbol_table str_list;
+    int line_num = 0;
+    int char_num = 0;
+    vector<int> word_type_num = vector<int>(WORD_TYPE_AMOUNT);
+    string errors;      //分析过程中输出的错误信息
+    double ms = 0;      //分析耗时
+};
+
+static bool analyze_file(const string& path, bool use_table, analysis_result& result)
+{
+    source_buffer program;
+    if (!open_source(program, path))
+        return false;
+    //分析期间收集错误信息以便比较
+    ostringstream errors;
+    line_index lines(path, program.data, program.size);
+    error_output = &errors;
+    error_lines = &lines;
+    auto start = chrono::steady_clock::now();
+    if (use_table)
+        table_lexical_analysis(result.token_stream, result.id_list, result.str_list, result.line_num, result.word_type_num, result.char_num, program);
+    else
+        lexical_analysis(result.token_stream, result.id_list, result.str_list, result.line_num, result.word_type_num, result.char_num, program);
+    auto finish = chrono::steady_clock::now();
+    error_output = &cout;
+    error_lines = nullptr;
+    result.errors = errors.str();
+    result.ms = chrono::duration<double, milli>(finish - start).count();
+    return true;
+}
+
+bool compare_engines(const string& path)
+{
+    analysis_result switch_result, table_result;
+    if (!analyze_file(path, false, switch_result) || !analyze_file(path, true, table_result))
+    {
+        cerr << "cannot open " << path << endl;
+        return false;
+    }
+
+    bool same = true;
+    if (switch_result.token_stream.size() != table_result.token_stream.size())
+    {
+        cout << "token count differs: " << switch_result.token_stream.size() << " vs " << table_result.token_stream.size() << endl;
+        same = false;
+    }
+    token_buffer::const_iterator a = switch_result.token_stream.begin(), b = table_result.token_stream.begin();
+    for (size_t i = 0; same && i < switch_result.token_stream.size(); i++, ++a, ++b)
+    {
+        if ((*a).type != (*b).type || to_string(*a) != to_string(*b))
+        {
+            cout << "token " << i << " differs: " << to_string(*a) << " vs " << to_string(*b) << endl;
+            same = false;
+        }
+        else if (switch_result.token_stream.offset(i) != table_result.token_stream.offset(i) || switch_result.token_stream.length(i) != table_result.token_stream.length(i))
+        {
+            cout << "token " << i << " position differs: " << switch_result.token_stream.offset(i) << "+" << switch_result.token_stream.length(i)
+                << " vs " << table_result.token_stream.offset(i) << "+" << table_result.token_stream.length(i) << endl;
+            same = false;
+        }
+    }
+    if (switch_result.id_list.size() != table_result.id_list.size() || switch_result.str_list.size() != table_result.str_list.size())
+    {
+        cout << "symbol table size differs" << endl;
+        same = false;
+    }
+    for (size_t i = 0; same && i < switch_result.id_list.size(); i++)
+        same = switch_result.id_list[i] == table_result.id_list[i];
+    for (size_t i = 0; same && i < switch_result.str_list.size(); i++)
+        same = switch_result.str_list[i] == table_result.str_list[i];
+    if (switch_result.word_type_num != table_result.word_type_num || switch_result.line_num != table_result.line_num
+        || switch_result.char_num != table_result.char_num)
+    {
+        cout << "statistics differ" << endl;
+        same = false;
+    }
+    if (switch_result.errors != table_result.errors)
+    {
+        cout << "error reports differ" << endl;
+        same = false;
+    }
+
+    cout << (same ? "engines agree" : "engines differ") << ": " << switch_result.token_stream.size() << " tokens" << endl;
+    cout << "switch: " << switch_result.ms << " ms" << endl;
+    cout << "table:  " << table_result.ms << " ms" << endl;
+    return same;
+}
+
+template class lexer<ifstream>;
+template class lexer<source_buffer>;
+template void lexical_analysis(token_buffer&, symbol_table&, symbol_table&, int&, vector<int>&, int&, ifstream&);
+template void lexical_analysis(token_buffer&, symbol_table&, symbol_table&, int&, vector<int>&, int&, source_buffer&);
+template void table_lexical_analysis(token_buffer&, symbol_table&, symbol_table&, int&, vector<int>&, int&, ifstream&);
+template void table_lexical_analysis(token_buffer&, symbol_table&, symbol_table&, int&, vector<int>&, int&, source_buffer&);
@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "token.h"
+#include "token_buffer.h"
+#include "symbol_table.h"
+
+extern const std::vector<std::string> KEYWORD_LIST;
+
+//词法分析结果的版本，DFA识别的记号、数值或报告的错误改变时（即使记号文件格式不变）须加1，使词法分析缓存中旧的结果失效
+constexpr uint64_t LEXER_VERSION = 1;
+
+//单词类型在输出中的名称
+std::string_view word_type_name(word_type type);
+
+std::string to_string(word_type type);
+
+std::string to_string(struct token token);
+
+//词法错误的输出位置，默认为cout，每个线程可以单独设置，以便并行分析时分别收集各文件的错误；为nullptr时不输出
+extern thread_local std::ostream* error_output;
+
+//词法错误：出错的单词及其在源程序中的字节偏移
+struct lexical_error
+{
+    size_t offset;
+    std::string word;
+};
+
+//不为nullptr时，报告的词法错误同时记录在其中，以便保存后重新报告；与error_output一样每个线程单独设置
+extern thread_local std::vector<lexical_error>* error_log;
+
+//报告词法错误，offset为出错单词在源程序中的字节偏移，由error_lines换算为文件名、行号和列号
+void error(std::string_view str, size_t offset);
+
+/**
+ * 将分析出的记号加入记号流，关键字和标志符查找关键字表或插入标志符表，字符串插入字符串表，字符和浮点常量求值
+ * size_t offset - 单词在源程序中的字节偏移，用于报告错误
+ * const word_type& type - 单词类型，关键字也以ID传入
+ * std::string_view buf - 单词内容，字符和字符串常量不含引号，浮点常量不含后缀，界符不需要
+ */
+void word_analysis(std::vector<struct token>& token_stream, symbol_table& id_list, symbol_table& str_list, std::vector<int>& word_type_num,
+    size_t offset, const word_type& type, std::string_view buf = {});
+
+/**
+ * 对输入程序进行词法分析，输出对应记号流，统计源程序中的语句行数、各类单词的个数、以及字符总数，同时检查源程序中存在的词法错误，并报告错误所在的位置
+ * token_buffer& token_stream - 需要返回的记号流，包含各记号在源程序中的位置
+ * symbol_table& id_list - 标志符表
+ * symbol_table& str_list - 字符串表
+ * int& line_num - 行数
+ * std::vector<int>& word_type_num - 每种单词类型的数量
+ * int& char_num - 字符总数
+ * Source& program - 源程序，ifstream逐字符读取，source_buffer在内存中以游标读取
+ */
+template <class Source>
+void lexical_analysis(token_buffer& token_stream, symbol_table& id_list, symbol_table& str_list, int& line_num, std::vector<int>& word_type_num, int& char_num, Source& program);
+
+//表驱动DFA实现的词法分析，参数与结果均与lexical_analysis相同
+template <class Source>
+void table_lexical_analysis(token_buffer& token_stream, symbol_table& id_list, symbol_table& str_list, int& line_num, std::vector<int>& word_type_num, int& char_num, Source& program);
+
+/**
+ * 分别用switch实现和表驱动DFA分析同一源程序，比较记号流、符号表、统计结果和错误信息是否完全一致，并输出两者耗时
+ * const std::string& path - 源程序路径
+ * 一致返回true
+ */
+bool compare_engines(const std::string& path);
@@ -0,0 +1,40 @@
+﻿#include "line_index.h"
+#include "simd_scan.h"
+#include <algorithm>
+
+using namespace std;
+
+thread_local const line_index* error_lines = nullptr;
+
+line_index::line_index(const string& path, const char* data, size_t size) : path(path), data(data), size(size)
+{
+}
+
+line_index::line_index(const string& path) : path(path), data(nullptr), size(0)
+{
+}
+
+void line_index::build() const
+{
+    if (data == nullptr && open_source(storage, path))
+    {
+        data = storage.data;
+        size = storage.size;
+    }
+    line_starts.push_back(0);
+    //EOF字符之后的内容不会被分析，索引到此为止
+    for (size_t pos = 0; pos < size; )
+    {
+        pos += scan->find_line_end(data + pos, size - pos);
+        if (pos >= size || data[pos] != '\n')
+            break;
+        line_starts.push_back(++pos);
+    }
+}
+
+source_location line_index::locate(size_t offset) const
+{
+    call_once(built, [this] { build(); });
+    size_t line = upper_bound(line_starts.begin(), line_starts.end(), offset) - line_starts.begin();
+    return { (int)line, (int)(offset - line_starts[line - 1]) + 1 };
+}
@@ -0,0 +1,53 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "source_buffer.h"
+
+//源程序中的位置，行号和列号都从1开始，列号按字节计算
+struct source_location
+{
+    int line;
+    int column;
+};
+
+/**
+ * 源程序的行首索引，把字节偏移换算为行号和列号
+ * 第一次查询时才用扫描内核找出全部换行并建立索引，之后按二分查找定位，可被多个线程同时查询
+ * 词法分析只需记录单词的字节偏移，只有报告错误或位置时才需要建立索引
+ */
+class line_index
+{
+public:
+    //索引内存中的源程序，data需在索引使用期间保持有效
+    line_index(const std::string& path, const char* data, size_t size);
+
+    //第一次查询时才读入path
+    explicit line_index(const std::string& path);
+
+    line_index(const line_index&) = delete;
+    line_index& operator=(const line_index&) = delete;
+
+    const std::string& get_path() const { return path; }
+
+    //offset所在的行号和列号
+    source_location locate(size_t offset) const;
+
+private:
+    void build() const;
+
+    std::string path;
+    mutable const char* data;
+    mutable size_t size;
+    mutable source_buffer storage;              //按路径读入时的源程序
+    mutable std::once_flag built;
+    mutable std::vector<uint32_t> line_starts;  //每行首字节的偏移
+};
+
+/**
+ * 词法错误报告位置时使用的行首索引，与error_output一样每个线程单独设置
+ * 为nullptr时错误只报告字节偏移
+ */
+extern thread_local const line_index* error_lines;
@@ -0,0 +1,38 @@
+﻿#include "literal.h"
+#include <charconv>
+
+using namespace std;
+
+size_t parse_integer(string_view str, unsigned base, integer_literal& number)
+{
+    literal_clear(number);
+    size_t i = 0;
+    for (; i < str.size(); i++)
+    {
+        char c = str[i];
+        bool is_digit = base == 16 ? (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F') : c >= '0' && c < (char)('0' + base);
+        if (!is_digit)
+            break;
+        literal_push(number, c, base);
+    }
+    return i;
+}
+
+//from_chars不依赖区域设置、不抛出异常，要求整个常量都被解析
+template <class Real>
+static bool parse_real_impl(string_view str, Real& value)
+{
+    const char* last = str.data() + str.size();
+    from_chars_result result = from_chars(str.data(), last, value);
+    return result.ec == errc() && result.ptr == last;
+}
+
+bool parse_real(string_view str, float& value)
+{
+    return parse_real_impl(str, value);
+}
+
+bool parse_real(string_view str, double& value)
+{
+    return parse_real_impl(str, value);
+}
@@ -0,0 +1,49 @@
+﻿#pragma once
+#include <cstddef>
+#include <string_view>
+
+//整型常量，DFA扫描数字的同时逐位累加其值，无需在识别结束后再从字符串转换
+struct integer_literal
+{
+    unsigned long long value = 0;
+    bool overflow = false;          //累加过程中是否超出unsigned long long的范围
+};
+
+//开始累加新的整型常量
+inline void literal_clear(integer_literal& number)
+{
+    number.value = 0;
+    number.overflow = false;
+}
+
+//数字字符c的值，c必须为0-9、a-f或A-F
+inline unsigned digit_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return c - 'A' + 10;
+}
+
+//将base进制的数字字符c累加到number的末尾
+inline void literal_push(integer_literal& number, char c, unsigned base)
+{
+    unsigned d = digit_value(c);
+    if (number.value > (~0ull - d) / base)
+        number.overflow = true;
+    number.value = number.value * base + d;
+}
+
+/**
+ * 解析str开头连续的base进制数字，返回解析的字符数
+ * std::string_view str - 需要解析的字符串
+ * unsigned base - 进制，8或16
+ * integer_literal& number - 解析结果
+ */
+size_t parse_integer(std::string_view str, unsigned base, integer_literal& number);
+
+//将实型常量str转换为浮点数，格式错误或超出范围时返回false
+bool parse_real(std::string_view str, float& value);
+
+bool parse_real(std::string_view str, double& value);
@@ -0,0 +1,546 @@
+﻿#include <iostream>
+#include <string>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include "lexical_analysis.h"
+#include "source_buffer.h"
+#include "benchmark.h"
+#include "alloc_counter.h"
+#include "simd_scan.h"
+#include "batch.h"
+#include "parallel_lexer.h"
+#include "line_index.h"
+#include "output_buffer.h"
+#include "token_file.h"
+#include "lex_cache.h"
+#include "corpus_generator.h"
+#include "lexer_profile.h"
+#include "lex_server.h"
+#include "concurrent_symbol_table.h"
+#include "frequency_summary.h"
+
+using namespace std;
+
+/**
+ * 用法: lexical_analysis [选项] [源程序路径]
+ *       lexical_analysis --batch [选项] 文件或目录...
+ *       lexical_analysis --serve=SOCKET [--threads=N]
+ *       lexical_analysis --load-test=SOCKET [选项] [文件或目录...]
+ *       lexical_analysis --merge-stats [--top=K] [--stats-out=FILE] 汇总文件...
+ * --stream - 使用ifstream逐字符读取源程序
+ * --mmap - 将源程序整体载入内存后分析（默认）
+ * --switch - 使用switch实现的DFA（默认）
+ * --table - 使用表驱动DFA
+ * --compare-engines - 比较switch实现与表驱动DFA的分析结果和耗时后退出
+ * --scan=scalar|sse2|avx2 - 指定整块跳过空白、标志符和注释时使用的扫描内核，默认根据CPUID选择
+ * --time - 在标准错误输出词法分析耗时，用于比较两种读取方式的吞吐量
+ * --bench-keyword - 运行关键字识别微基准测试后退出
+ * --bench-output - 比较只做词法分析与分析后输出记号流的吞吐量后退出
+ * --bench-incremental - 在源程序中模拟键入，测试增量分析每次编辑的耗时并与整体分析比较结果
+ * --bench-token-file - 比较二进制记号文件与文本输出的大小和读写速度，并检查记号文件能否完整还原分析结果
+ * --bench-session - 比较连续分析大量小源程序时每次新建结果与重复使用lexer_session的吞吐量和堆分配次数后退出
+ * --bench-corpus[=MIX,...] - 在合成语料上测试整体分析和reserve、table_insert、word_analysis各阶段的吞吐量，以JSON输出后退出
+ *                            MIX为balanced、identifier、number、comment、string、error，默认测试全部
+ * --corpus-size=N - 合成语料的字节数，默认为8MB
+ * --corpus-seed=N - 生成合成语料的随机种子，默认为1
+ * --json=FILE - --bench-corpus的JSON结果写入FILE，标准输出改为便于阅读的表格
+ * --generate-corpus=MIX - 把合成语料写到给出的路径（未给出时写到标准输出）后退出，可用于保存测试输入
+ * --write-tokens=FILE - 分析后把记号流、符号表和统计结果另存为二进制记号文件
+ * --read-tokens=FILE - 不分析源程序，从二进制记号文件读回结果并按相同格式输出
+ * --cache-dir=DIR - 使用DIR下以源程序内容哈希为键的词法分析缓存，命中时直接读回结果，结束时在标准错误输出命中和未命中次数
+ *                   只用于整块载入内存的单个源程序分析和批量分析，--stream和--parallel不使用缓存
+ * --count-alloc - 在标准错误输出词法分析期间的堆分配次数、符号表文本区的大小和进程的峰值常驻内存
+ * --max-alloc-per-token=X - 同--count-alloc，平均每个记号的堆分配次数超过X时不输出分析结果并以非零值退出，用于分配次数的回归测试
+ * --token-memory - 在标准错误输出记号流占用的内存
+ * --token-positions - 在输出末尾列出每个记号的文件名、行号和列号
+ * --batch - 并行分析多个文件或目录（递归查找.c和.h文件），输出各文件统计和合计结果
+ * --threads=N - 批量分析或分块并行分析使用的线程数，默认为硬件并发数
+ * --prefetch=off|threads|uring - 批量分析读取源程序的方式：各线程自己打开（默认）、读取线程预读、io_uring预读（不可用时改用读取线程）
+ * --global-ids - 批量分析时把各文件的标志符插入多个线程共用的全局标志符表，结束后输出整个项目不同标志符的个数
+ * --stats - 输出标志符和字符串的出现次数、关键字个数的频率统计；批量分析时汇总所有文件
+ * --top=K - 频率统计输出出现次数最多的K个标志符和字符串，默认为20
+ * --sketch=WIDTH - 频率统计使用每行WIDTH个计数器的计数最小略图近似统计，内存与不同符号数无关，默认精确统计
+ * --stats-out=FILE - 把频率统计汇总以二进制格式写入FILE，可由--merge-stats合并
+ * --merge-stats - 不分析源程序，合并给出的频率统计汇总文件并输出统计后退出；给出--sketch或任一汇总为近似统计时合并为近似统计
+ * --bench-intern - 测试1到N（--threads，默认为硬件并发数且至少为4）个线程同时插入全局标志符表的吞吐量后退出
+ * --bench-prefetch - 在冷页缓存上比较三种读取方式批量分析给出的文件或目录（未给出时使用生成的合成源程序）的耗时和空闲CPU时间后退出
+ * --serve=SOCKET - 在Unix域套接字SOCKET上运行词法分析服务，接收源程序路径或内容，返回二进制记号文件或文本输出（协议见lex_server.h）
+ * --load-test=SOCKET - 向SOCKET上的词法分析服务发送请求，输出requests/s和延迟的p50、p99后退出
+ *                      给出文件或目录时发送其中的源程序，否则发送生成的约4KB的合成源程序
+ * --connections=N - 压力测试的连接数，默认为4
+ * --pipeline=N - 压力测试每个连接未收到响应的最多请求数，默认为8
+ * --requests=N - 压力测试的请求总数，默认为20000
+ * --format=binary|text - 压力测试请求的响应格式，默认为binary
+ * --send-source - 压力测试以内容发送源程序，默认发送绝对路径
+ * --parallel - 将单个源程序分块并行分析（switch实现），结果与整体分析相同
+ * --chunk-size=N - 分块并行分析的分块字节数，默认为4MB
+ * 未给出源程序路径时分析program.txt
+ * 编译时定义LEXER_PROFILE（如g++ -DLEXER_PROFILE）时，结束前在标准错误输出DFA各状态和转移的次数、retract次数、符号表探测长度和word_analysis等的耗时
+ */
+int main(int argc, char* argv[])
+{
+#ifdef LEXER_PROFILE
+    //启用插桩时在main返回前输出热路径统计
+    struct profile_report { ~profile_report() { print_lexer_profile(cerr); } } report;
+#endif
+    string path = "program.txt";
+    vector<string> paths;
+    bool batch = false;
+    prefetch_mode prefetch = PREFETCH_OFF;
+    bool bench_prefetch = false;
+    bool global_ids = false;
+    bool bench_intern = false;
+    bool stats = false;
+    size_t top_k = 20;
+    size_t sketch_width = 0;
+    string stats_out;
+    bool merge_stats = false;
+    int thread_num = 0;
+    bool use_stream = false;
+    bool show_time = false;
+    bool count_alloc = false;
+    double max_alloc_per_token = -1;
+    bool token_memory = false;
+    bool token_positions = false;
+    bool use_table = false;
+    bool compare = false;
+    bool bench_output = false;
+    bool bench_token_file = false;
+    bool bench_incremental = false;
+    bool bench_corpus = false;
+    vector<corpus_mix> corpus_mixes;
+    string generate_mix;
+    size_t corpus_size = DEFAULT_CORPUS_SIZE;
+    uint32_t corpus_seed = 1;
+    string json_path;
+    string write_tokens;
+    string read_tokens;
+    string cache_dir;
+    string serve_socket;
+    string load_socket;
+    int connections = 4;
+    int pipeline = 8;
+    int requests = 20000;
+    response_format format = FORMAT_BINARY;
+    bool send_source = false;
+    bool parallel = false;
+    size_t chunk_size = DEFAULT_CHUNK_SIZE;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--stream")
+            use_stream = true;
+        else if (arg == "--mmap")
+            use_stream = false;
+        else if (arg == "--time")
+            show_time = true;
+        else if (arg == "--switch")
+            use_table = false;
+        else if (arg == "--table")
+            use_table = true;
+        else if (arg.compare(0, 7, "--scan=") == 0)
+        {
+            if (!select_scan_kernels(arg.c_str() + 7))
+            {
+                cerr << "unsupported scan kernels: " << arg.substr(7) << endl;
+                return 1;
+            }
+        }
+        else if (arg == "--compare-engines")
+            compare = true;
+        else if (arg == "--count-alloc")
+            count_alloc = true;
+        else if (arg.compare(0, 22, "--max-alloc-per-token=") == 0)
+        {
+            count_alloc = true;
+            max_alloc_per_token = atof(arg.c_str() + 22);
+        }
+        else if (arg == "--token-memory")
+            token_memory = true;
+        else if (arg == "--token-positions")
+            token_positions = true;
+        else if (arg == "--bench-keyword")
+        {
+            keyword_benchmark(cout);
+            return 0;
+        }
+        else if (arg == "--bench-output")
+            bench_output = true;
+        else if (arg == "--bench-token-file")
+            bench_token_file = true;
+        else if (arg == "--bench-incremental")
+            bench_incremental = true;
+        else if (arg == "--bench-session")
+            return session_benchmark(cout) ? 0 : 1;
+        else if (arg.compare(0, 14, "--bench-corpus") == 0 && (arg.size() == 14 || arg[14] == '='))
+        {
+            bench_corpus = true;
+            for (size_t start = 15; start < arg.size(); )
+            {
+                size_t end = arg.find(',', start);
+                if (end == string::npos)
+                    end = arg.size();
+                corpus_mix mix;
+                if (!parse_corpus_mix(string_view(arg).substr(start, end - start), mix))
+                {
+                    cerr << "unknown corpus mix: " << arg.substr(start, end - start) << endl;
+                    return 1;
+                }
+                corpus_mixes.push_back(mix);
+                start = end + 1;
+            }
+        }
+        else if (arg.compare(0, 18, "--generate-corpus=") == 0)
+            generate_mix = arg.substr(18);
+        else if (arg.compare(0, 14, "--corpus-size=") == 0)
+            corpus_size = strtoull(arg.c_str() + 14, nullptr, 10);
+        else if (arg.compare(0, 14, "--corpus-seed=") == 0)
+            corpus_seed = strtoul(arg.c_str() + 14, nullptr, 10);
+        else if (arg.compare(0, 7, "--json=") == 0)
+            json_path = arg.substr(7);
+        else if (arg.compare(0, 15, "--write-tokens=") == 0)
+            write_tokens = arg.substr(15);
+        else if (arg.compare(0, 14, "--read-tokens=") == 0)
+            read_tokens = arg.substr(14);
+        else if (arg.compare(0, 12, "--cache-dir=") == 0)
+            cache_dir = arg.substr(12);
+        else if (arg == "--batch")
+            batch = true;
+        else if (arg.compare(0, 11, "--prefetch=") == 0)
+        {
+            if (!parse_prefetch_mode(string_view(arg).substr(11), prefetch))
+            {
+                cerr << "unknown prefetch mode: " << arg.substr(11) << endl;
+                return 1;
+            }
+        }
+        else if (arg == "--bench-prefetch")
+            bench_prefetch = true;
+        else if (arg == "--global-ids")
+            global_ids = true;
+        else if (arg == "--bench-intern")
+            bench_intern = true;
+        else if (arg == "--stats")
+            stats = true;
+        else if (arg.compare(0, 6, "--top=") == 0)
+            top_k = strtoull(arg.c_str() + 6, nullptr, 10);
+        else if (arg.compare(0, 9, "--sketch=") == 0)
+            sketch_width = strtoull(arg.c_str() + 9, nullptr, 10);
+        else if (arg.compare(0, 12, "--stats-out=") == 0)
+            stats_out = arg.substr(12);
+        else if (arg == "--merge-stats")
+            merge_stats = true;
+        else if (arg.compare(0, 10, "--threads=") == 0)
+            thread_num = atoi(arg.c_str() + 10);
+        else if (arg.compare(0, 8, "--serve=") == 0)
+            serve_socket = arg.substr(8);
+        else if (arg.compare(0, 12, "--load-test=") == 0)
+            load_socket = arg.substr(12);
+        else if (arg.compare(0, 14, "--connections=") == 0)
+            connections = atoi(arg.c_str() + 14);
+        else if (arg.compare(0, 11, "--pipeline=") == 0)
+            pipeline = atoi(arg.c_str() + 11);
+        else if (arg.compare(0, 11, "--requests=") == 0)
+            requests = atoi(arg.c_str() + 11);
+        else if (arg == "--format=binary" || arg == "--format=text")
+            format = arg == "--format=text" ? FORMAT_TEXT : FORMAT_BINARY;
+        else if (arg == "--send-source")
+            send_source = true;
+        else if (arg == "--parallel")
+            parallel = true;
+        else if (arg.compare(0, 13, "--chunk-size=") == 0)
+            chunk_size = strtoull(arg.c_str() + 13, nullptr, 10);
+        else
+            paths.push_back(arg);
+    }
+    if (!paths.empty())
+        path = paths.front();
+
+    if (!serve_socket.empty())
+    {
+        serve(serve_socket, thread_num);
+        cerr << "cannot serve on " << serve_socket << endl;
+        return 1;
+    }
+
+    if (!load_socket.empty())
+        return load_test(cout, load_socket, paths, send_source, format, connections, pipeline, requests) ? 0 : 1;
+
+    unique_ptr<lex_cache> cache;
+    if (!cache_dir.empty())
+        cache = make_unique<lex_cache>(cache_dir);
+
+    if (bench_prefetch)
+        return prefetch_benchmark(cout, paths, thread_num) ? 0 : 1;
+
+    if (bench_intern)
+        return intern_benchmark(cout, thread_num) ? 0 : 1;
+
+    unique_ptr<frequency_summary> summary;
+    if (stats || !stats_out.empty())
+        summary = make_unique<frequency_summary>(sketch_width);
+
+    if (merge_stats)
+    {
+        vector<unique_ptr<frequency_summary>> parts;
+        for (const string& part_path : paths)
+        {
+            parts.push_back(make_unique<frequency_summary>());
+            if (!parts.back()->read(part_path))
+            {
+                cerr << "invalid frequency summary " << part_path << endl;
+                return 1;
+            }
+        }
+        //给出--sketch或任一汇总为近似统计时合并为近似统计，精确统计的汇总并入其中，结果与汇总的顺序无关
+        size_t width = sketch_width;
+        size_t depth = DEFAULT_SKETCH_DEPTH;
+        for (const unique_ptr<frequency_summary>& part : parts)
+        {
+            if (width == 0 && part->get_ids().is_sketch())
+            {
+                width = part->get_ids().get_width();
+                depth = part->get_ids().get_depth();
+            }
+        }
+        //先合并近似统计的汇总，再逐个并入精确统计的汇总
+        frequency_summary merged(width, depth);
+        for (bool sketches : { true, false })
+        {
+            for (size_t i = 0; i < parts.size(); i++)
+            {
+                if (parts[i]->get_ids().is_sketch() == sketches && !merged.merge(*parts[i]))
+                {
+                    cerr << "cannot merge " << paths[i] << ": sketch sizes differ" << endl;
+                    return 1;
+                }
+            }
+        }
+        print_frequency_report(cout, merged, top_k);
+        if (!stats_out.empty() && !merged.write(stats_out))
+        {
+            cerr << "cannot write " << stats_out << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (batch)
+    {
+        vector<file_statistics> results;
+        unique_ptr<concurrent_symbol_table> project_ids;
+        if (global_ids)
+            project_ids = make_unique<concurrent_symbol_table>();
+        auto start = chrono::steady_clock::now();
+        batch_analysis(collect_sources(paths), thread_num, use_table, results, cache.get(), prefetch, project_ids.get(), summary.get());
+        auto finish = chrono::steady_clock::now();
+        print_batch_report(cout, results);
+        if (project_ids)
+            cout << "distinct identifiers across files: " << project_ids->size() << endl;
+        if (summary && stats)
+            print_frequency_report(cout, *summary, top_k);
+        if (summary && !stats_out.empty() && !summary->write(stats_out))
+        {
+            cerr << "cannot write " << stats_out << endl;
+            return 1;
+        }
+        if (show_time)
+            cerr << "batch lexical analysis: " << chrono::duration<double, milli>(finish - start).count() << " ms" << endl;
+        if (cache)
+            cerr << "lexing cache: " << cache->get_hits() << " hits, " << cache->get_misses() << " misses" << endl;
+        return 0;
+    }
+
+    if (compare)
+        return compare_engines(path) ? 0 : 1;
+
+    if (bench_output || bench_token_file)
+    {
+        if (bench_output ? output_benchmark(cout, path) : token_file_benchmark(cout, path))
+            return 0;
+        cerr << "cannot open " << path << endl;
+        return 1;
+    }
+
+    if (bench_incremental)
+        return incremental_benchmark(cout, path) ? 0 : 1;
+
+    if (!generate_mix.empty())
+    {
+        corpus_mix mix;
+        if (!parse_corpus_mix(generate_mix, mix))
+        {
+            cerr << "unknown corpus mix: " << generate_mix << endl;
+            return 1;
+        }
+        string corpus = generate_corpus(mix, corpus_size, corpus_seed);
+        if (paths.empty())
+        {
+            cout.write(corpus.data(), corpus.size());
+            return 0;
+        }
+        ofstream file(path, ios::binary);
+        if (!file.write(corpus.data(), corpus.size()))
+        {
+            cerr << "cannot write " << path << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (bench_corpus)
+    {
+        if (corpus_mixes.empty())
+            for (int i = 0; i < CORPUS_MIX_AMOUNT; i++)
+                corpus_mixes.push_back((corpus_mix)i);
+        if (json_path.empty())
+        {
+            corpus_benchmark(cout, nullptr, corpus_mixes, corpus_size, corpus_seed);
+            return 0;
+        }
+        ofstream json(json_path);
+        if (!json)
+        {
+            cerr << "cannot open " << json_path << endl;
+            return 1;
+        }
+        corpus_benchmark(json, &cout, corpus_mixes, corpus_size, corpus_seed);
+        return 0;
+    }
+
+    token_buffer token_stream;
+    symbol_table id_list;
+    symbol_table str_list;
+    int line_num = 0;
+    int char_num = 0;
+    vector<int> word_type_num(WORD_TYPE_AMOUNT);
+
+    cout << "Designed by CHEN YU, built: " << __DATE__ << " " <<  __TIME__ << endl;
+
+    if (!read_tokens.empty())
+    {
+        token_file file;
+        if (!file.open(read_tokens))
+        {
+            cerr << "invalid token file " << read_tokens << endl;
+            return 1;
+        }
+        file.load(token_stream, id_list, str_list, line_num, word_type_num, char_num);
+        output_buffer output(cout);
+        print_analysis(output, token_stream, id_list, str_list, line_num, word_type_num, char_num);
+        return 0;
+    }
+
+    //只有报告错误或记号位置时才读入源程序建立行首索引
+    line_index lines(path);
+    error_lines = &lines;
+
+    size_t alloc_start = allocation_count();
+    auto start = chrono::steady_clock::now();
+    if (use_stream)
+    {
+        ifstream program;
+        program.open(path, ios::in);
+        if (!program)
+        {
+            cerr << "cannot open " << path << endl;
+            return 1;
+        }
+        if (use_table)
+            table_lexical_analysis(token_stream, id_list, str_list, line_num, word_type_num, char_num, program);
+        else
+            lexical_analysis(token_stream, id_list, str_list, line_num, word_type_num, char_num, program);
+    }
+    else
+    {
+        source_buffer program;
+        if (!open_source(program, path))
+        {
+            cerr << "cannot open " << path << endl;
+            return 1;
+        }
+        if (cache && !parallel)
+            cache->analyze(token_stream, id_list, str_list, line_num, word_type_num, char_num, program, use_table);
+        else if (parallel)
+            parallel_lexical_analysis(token_stream, id_list, str_list, line_num, word_type_num, char_num, program, thread_num, chunk_size);
+        else if (use_table)
+            table_lexical_analysis(token_stream, id_list, str_list, line_num, word_type_num, char_num, program);
+        else
+            lexical_analysis(token_stream, id_list, str_list, line_num, word_type_num, char_num, program);
+    }
+    auto finish = chrono::steady_clock::now();
+    size_t alloc_finish = allocation_count();
+    if (count_alloc)
+    {
+        //记号流和符号表扩容的分配次数为O(log n)，其余均计入每个记号的分配
+        size_t allocs = alloc_finish - alloc_start;
+        cerr << "heap allocations: " << allocs << " for " << token_stream.size() << " tokens ("
+            << (token_stream.empty() ? 0.0 : (double)allocs / token_stream.size()) << " per token)" << endl;
+        cerr << "symbol text: " << id_list.get_text().size() + str_list.get_text().size() << " bytes in "
+            << id_list.get_text().block_count() + str_list.get_text().block_count() << " arena blocks, peak RSS: " << peak_memory_usage() / 1024 << " KB" << endl;
+        if (max_alloc_per_token >= 0 && allocs > max_alloc_per_token * token_stream.size())
+        {
+            cerr << "allocation check failed: more than " << max_alloc_per_token << " heap allocations per token" << endl;
+            return 1;
+        }
+    }
+    if (token_memory)
+    {
+        size_t bytes = token_stream.memory_usage();
+        cerr << "token buffer: " << bytes << " bytes for " << token_stream.size() << " tokens ("
+            << (token_stream.empty() ? 0.0 : (double)bytes / token_stream.size()) << " per token, struct token array: " << sizeof(struct token) << " per token)" << endl;
+    }
+    if (show_time)
+    {
+        double ms = chrono::duration<double, milli>(finish - start).count();
+        cerr << (use_stream ? "stream" : "mmap") << (parallel && !use_stream ? " parallel" : use_table ? " table" : " switch") << " lexical analysis (" << scan->name << " scan): " << ms << " ms" << endl;
+    }
+    if (!write_tokens.empty() && !write_token_file(write_tokens, token_stream, id_list, str_list, line_num, word_type_num, char_num))
+    {
+        cerr << "cannot write " << write_tokens << endl;
+        return 1;
+    }
+
+    //清单和记号流可能有数百万行，统一写入输出缓冲区后整块输出
+    output_buffer output(cout);
+    print_analysis(output, token_stream, id_list, str_list, line_num, word_type_num, char_num);
+
+    if (token_positions)
+    {
+        output.append("\ntoken positions:\n");
+        token_buffer::const_iterator it = token_stream.begin();
+        for (size_t i = 0; i < token_stream.size(); i++, ++it)
+        {
+            source_location location = lines.locate(token_stream.offset(i));
+            output.append(path);
+            output.append(':');
+            output.append(location.line);
+            output.append(':');
+            output.append(location.column);
+            output.append(' ');
+            output.append_left(*it, 0);
+            output.append('\n');
+        }
+    }
+    output.flush();
+    error_lines = nullptr;
+    if (summary)
+    {
+        summary->add(id_list, str_list, word_type_num);
+        if (stats)
+            print_frequency_report(cout, *summary, top_k);
+        if (!stats_out.empty() && !summary->write(stats_out))
+        {
+            cerr << "cannot write " << stats_out << endl;
+            return 1;
+        }
+    }
+    if (cache)
+        cerr << "lexing cache: " << cache->get_hits() << " hits, " << cache->get_misses() << " misses" << endl;
+
+    return 0;
+}
+
@@ -0,0 +1,190 @@
+﻿#include "output_buffer.h"
+#include "lexical_analysis.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+using namespace std;
+
+//原先由ostream的默认格式输出浮点数，即精度为6的%g
+template <class Real>
+static char* format_real(char* first, char* last, Real value)
+{
+    return to_chars(first, last, value, chars_format::general, 6).ptr;
+}
+
+template <class Integer>
+static char* format_integer(char* first, char* last, Integer value)
+{
+    return to_chars(first, last, value).ptr;
+}
+
+size_t format_token(char* text, const struct token& token)
+{
+    char* last = text + TOKEN_TEXT_MAX;
+    char* p = text;
+    *p++ = '<';
+    string_view name = word_type_name(token.type);
+    memcpy(p, name.data(), name.size());
+    p += name.size();
+    *p++ = ',';
+    *p++ = ' ';
+    if (token.type == CHAR)
+        *p++ = token.value.c;
+    else if (token.type == INT || token.type == KEYWORD || token.type == ID || token.type == STRING)
+        p = format_integer(p, last, token.value.i);
+    else if (token.type == UINT)
+        p = format_integer(p, last, token.value.ui);
+    else if (token.type == LONG)
+        p = format_integer(p, last, token.value.l);
+    else if (token.type == ULONG)
+        p = format_integer(p, last, token.value.ul);
+    else if (token.type == FLOAT)
+        p = format_real(p, last, token.value.f);
+    else if (token.type == DOUBLE)
+        p = format_real(p, last, token.value.d);
+    else if (token.type == RELATION_OPERATOR || token.type == ASSIGN_OPERATOR)
+    {
+        string_view attribute = word_type_name((word_type)token.value.i);
+        memcpy(p, attribute.data(), attribute.size());
+        p += attribute.size();
+    }
+    *p++ = '>';
+    return p - text;
+}
+
+output_buffer::output_buffer(ostream& out, size_t capacity) : out(&out), buffer(capacity)
+{
+}
+
+output_buffer::output_buffer(string& target) : target(&target), used(target.size())
+{
+}
+
+char* output_buffer::reserve(size_t n)
+{
+    if (target)
+    {
+        //按倍数扩大字符串，flush时再截断
+        if (used + n > target->size())
+            target->resize(max(used + n, target->size() * 2));
+        return &(*target)[used];
+    }
+    if (used + n > buffer.size())
+    {
+        flush();
+        if (n > buffer.size())
+            buffer.resize(n);
+    }
+    return buffer.data() + used;
+}
+
+void output_buffer::flush()
+{
+    if (target)
+    {
+        target->resize(used);
+        return;
+    }
+    if (used > 0)
+        out->write(buffer.data(), used);
+    used = 0;
+}
+
+void output_buffer::pad(size_t length, size_t width)
+{
+    if (length >= width)
+        return;
+    memset(reserve(width - length), ' ', width - length);
+    used += width - length;
+}
+
+void output_buffer::append(string_view str)
+{
+    memcpy(reserve(str.size()), str.data(), str.size());
+    used += str.size();
+}
+
+void output_buffer::append(long long value)
+{
+    char* p = reserve(24);
+    used += format_integer(p, p + 24, value) - p;
+}
+
+void output_buffer::append_left(string_view str, size_t width)
+{
+    append(str);
+    pad(str.size(), width);
+}
+
+void output_buffer::append_left(long long value, size_t width)
+{
+    char text[24];
+    append_left(string_view(text, format_integer(text, text + sizeof(text), value) - text), width);
+}
+
+void output_buffer::append_left(const struct token& token, size_t width)
+{
+    size_t length = format_token(reserve(TOKEN_TEXT_MAX), token);
+    used += length;
+    pad(length, width);
+}
+
+void print_token_stream(output_buffer& output, const token_buffer& token_stream)
+{
+    size_t column = 0;
+    for (struct token token : token_stream)
+    {
+        output.append_left(token, 11);
+        output.append(' ');
+        if (++column == 10)
+        {
+            output.append('\n');
+            column = 0;
+        }
+    }
+    if (column > 0)
+        output.append('\n');
+}
+
+void print_analysis(output_buffer& output, const token_buffer& token_stream, const symbol_table& id_list, const symbol_table& str_list,
+    int line_num, const vector<int>& word_type_num, int char_num)
+{
+    output.append("\nkeyword list:\n");
+    for (size_t i = 0; i < KEYWORD_LIST.size(); i++) {
+        output.append_left(i, 10);
+        output.append(KEYWORD_LIST[i]);
+        output.append('\n');
+    }
+
+    output.append("\nID list:\n");
+    for (size_t i = 0; i < id_list.size(); i++) {
+        output.append_left(i, 10);
+        output.append(id_list[i]);
+        output.append('\n');
+    }
+
+    output.append("\nstring list:\n");
+    for (size_t i = 0; i < str_list.size(); i++) {
+        output.append_left(i, 10);
+        output.append(str_list[i]);
+        output.append('\n');
+    }
+
+    output.append("\ntoken stream:\n");
+    print_token_stream(output, token_stream);
+
+    output.append("\nword type num:\n");
+    for (size_t i = 0; i < word_type_num.size(); i++)
+    {
+        output.append_left(word_type_name((word_type)i), 14);
+        output.append(word_type_num[i]);
+        output.append('\n');
+    }
+
+    output.append("char num: ");
+    output.append(char_num);
+    output.append("\nline num: ");
+    output.append(line_num);
+    output.append('\n');
+}
@@ -0,0 +1,65 @@
+﻿#pragma once
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "token.h"
+#include "token_buffer.h"
+#include "symbol_table.h"
+
+//记号文本"<类型, 属性>"的最大长度
+constexpr size_t TOKEN_TEXT_MAX = 64;
+
+/**
+ * 把记号格式化为"<类型, 属性>"，与原先用ostringstream输出的文本逐字节相同
+ * char* text - 输出位置，至少需要TOKEN_TEXT_MAX字节
+ * 返回写入的字节数
+ */
+size_t format_token(char* text, const struct token& token);
+
+/**
+ * 带缓冲的输出
+ * 内容先写入可重复使用的大缓冲区，装满或flush时才一次写入out；整数和浮点数用to_chars格式化，不经过iostream
+ * 输出到字符串时直接追加在字符串末尾，字符串本身即为缓冲区，重复使用同一字符串时不再分配
+ */
+class output_buffer
+{
+public:
+    explicit output_buffer(std::ostream& out, size_t capacity = 1 << 16);
+    explicit output_buffer(std::string& target);
+    ~output_buffer() { flush(); }
+
+    output_buffer(const output_buffer&) = delete;
+    output_buffer& operator=(const output_buffer&) = delete;
+
+    void append(char c) { *reserve(1) = c; used++; }
+    void append(std::string_view str);
+    void append(long long value);
+    void append(int value) { append((long long)value); }
+
+    //左对齐并用空格补足width个字符，与setiosflags(ios::left) << setw(width)相同
+    void append_left(std::string_view str, size_t width);
+    void append_left(long long value, size_t width);
+    void append_left(const struct token& token, size_t width);
+
+    //把缓冲区内容写入out；输出到字符串时把字符串截断到已写入的内容
+    void flush();
+
+private:
+    //保证缓冲区还有n个字节的空间，返回可写入的位置
+    char* reserve(size_t n);
+    void pad(size_t length, size_t width);
+
+    std::ostream* out = nullptr;
+    std::string* target = nullptr;
+    std::vector<char> buffer;
+    size_t used = 0;
+};
+
+//按每行10个、每个左对齐11个字符的格式输出记号流
+void print_token_stream(output_buffer& output, const token_buffer& token_stream);
+
+//输出关键字表、标志符表、字符串表、记号流和统计结果，与命令行程序的输出相同
+void print_analysis(output_buffer& output, const token_buffer& token_stream, const symbol_table& id_list, const symbol_table& str_list,
+    int line_num, const std::vector<int>& word_type_num, int char_num);
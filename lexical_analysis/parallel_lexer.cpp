@@ -0,0 +1,187 @@
+﻿#include "parallel_lexer.h"
+#include "lexical_analysis.h"
+#include "lexer.h"
+#include "line_index.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <string_view>
+
+using namespace std;
+
+//单个分块的推测分析结果，以及前一分块以注释结束时重新分析的结果
+struct chunk_result
+{
+    size_t begin = 0;
+    size_t end = 0;
+    int newlines = 0;               //分块内的换行数
+
+    token_buffer token_stream;
+    symbol_table id_list;
+    symbol_table str_list;
+    ostringstream errors;
+    chunk_control control;
+
+    token_buffer relex_token_stream;
+    symbol_table relex_id_list;
+    symbol_table relex_str_list;
+    ostringstream relex_errors;
+    chunk_control relex_control;
+};
+
+//合并时的一段连续记号，编号属于段内的符号表
+struct chunk_segment
+{
+    const token_buffer* token_stream;
+    size_t first_token;
+    const symbol_table* id_list;
+    const symbol_table* str_list;
+    string_view errors;
+};
+
+//EOF字符之后的内容不会被分析
+static size_t analysis_end(const source_buffer& program)
+{
+    const void* eof = memchr(program.data, (unsigned char)EOF, program.size);
+    return eof ? (const char*)eof - program.data : program.size;
+}
+
+//在[0, end)中按chunk_size切分，边界取在下一个换行之后
+static vector<size_t> split_chunks(const source_buffer& program, size_t end, size_t chunk_size)
+{
+    vector<size_t> bounds = { 0 };
+    while (end - bounds.back() > chunk_size)
+    {
+        size_t target = bounds.back() + chunk_size - 1;
+        const void* newline = memchr(program.data + target, '\n', end - target);
+        if (newline == nullptr)
+            break;
+        size_t bound = (const char*)newline - program.data + 1;
+        if (bound >= end)
+            break;
+        bounds.push_back(bound);
+    }
+    bounds.push_back(end);
+    return bounds;
+}
+
+static void analyze_chunk(chunk_result& chunk, const source_buffer& program, int state, token_buffer& token_stream,
+    symbol_table& id_list, symbol_table& str_list, ostringstream& errors, chunk_control& control)
+{
+    source_buffer view;
+    view.data = program.data + chunk.begin;
+    view.size = chunk.end - chunk.begin;
+    ostream* output = error_output;
+    error_output = &errors;
+    lexer<source_buffer> lex(id_list, str_list, view, chunk.begin, state, &control);
+    struct token token;
+    while (lex.next_token(token))
+        token_stream.push_back(token, lex.get_token_offset(), lex.get_token_length());
+    error_output = output;
+}
+
+static void merge_segment(const chunk_segment& segment, token_buffer& token_stream, symbol_table& id_list, symbol_table& str_list, vector<int>& word_type_num)
+{
+    vector<int> id_map(segment.id_list->size(), -1);
+    vector<int> str_map(segment.str_list->size(), -1);
+    const token_buffer& tokens = *segment.token_stream;
+    for (token_buffer::const_iterator it = tokens.iterator_at(segment.first_token); it != tokens.end(); ++it)
+    {
+        struct token token = *it;
+        if (token.type == ID)
+        {
+            int& entry = id_map[token.value.i];
+            if (entry == -1)
+                entry = id_list.insert((*segment.id_list)[token.value.i], 0);
+            id_list.add_count(entry, 1);
+            token.value.i = entry;
+        }
+        else if (token.type == STRING)
+        {
+            int& entry = str_map[token.value.i];
+            if (entry == -1)
+                entry = str_list.insert((*segment.str_list)[token.value.i], 0);
+            str_list.add_count(entry, 1);
+            token.value.i = entry;
+        }
+        else if (token.type == KEYWORD)
+            id_list.add_keyword_count(token.value.i);
+        word_type_num[token.type]++;
+        token_stream.push_back(token, tokens.offset(it.position()), tokens.length(it.position()));
+    }
+    *error_output << segment.errors;
+}
+
+void parallel_lexical_analysis(token_buffer& token_stream, symbol_table& id_list, symbol_table& str_list, int& line_num, vector<int>& word_type_num, int& char_num, source_buffer& program,
+    int thread_num, size_t chunk_size)
+{
+    size_t end = analysis_end(program);
+    vector<size_t> bounds = split_chunks(program, end, max(chunk_size, (size_t)1));
+    if (bounds.size() <= 2)
+    {
+        lexical_analysis(token_stream, id_list, str_list, line_num, word_type_num, char_num, program);
+        return;
+    }
+
+    //记号和错误的位置都是整个源程序中的字节偏移，各分块可以直接推测分析，错误由同一行首索引定位
+    vector<chunk_result> chunks(bounds.size() - 1);
+    const line_index* lines = error_lines;
+    thread_pool pool(thread_num);
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        chunks[i].begin = bounds[i];
+        chunks[i].end = bounds[i + 1];
+        chunks[i].control.last_chunk = chunks[i].relex_control.last_chunk = i + 1 == chunks.size();
+        pool.submit([&chunks, &program, lines, i](int) {
+            chunk_result& chunk = chunks[i];
+            error_lines = lines;
+            chunk.newlines = (int)count(program.data + chunk.begin, program.data + chunk.end, '\n');
+            analyze_chunk(chunk, program, 0, chunk.token_stream, chunk.id_list, chunk.str_list, chunk.errors, chunk.control);
+        });
+    }
+    pool.wait();
+
+    //按顺序确定每个分块的真实起始状态，起始于注释中的分块重新分析到与推测分析同步为止
+    vector<string> errors(chunks.size() * 2);
+    vector<chunk_segment> segments;
+    const chunk_control* previous = nullptr;  //决定当前分块起始状态的分析
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        chunk_result& chunk = chunks[i];
+        int state = previous ? previous->exit_state : 0;
+        if (state == 0)
+        {
+            errors[i * 2] = chunk.errors.str();
+            segments.push_back({ &chunk.token_stream, 0, &chunk.id_list, &chunk.str_list, errors[i * 2] });
+            previous = &chunk.control;
+            continue;
+        }
+        chunk.relex_control.sync_points = &chunk.control.checkpoints;
+        chunk.relex_control.entry_offset = previous->exit_offset;
+        analyze_chunk(chunk, program, state, chunk.relex_token_stream, chunk.relex_id_list, chunk.relex_str_list, chunk.relex_errors, chunk.relex_control);
+        errors[i * 2] = chunk.relex_errors.str();
+        segments.push_back({ &chunk.relex_token_stream, 0, &chunk.relex_id_list, &chunk.relex_str_list, errors[i * 2] });
+        if (chunk.relex_control.synced)
+        {
+            const chunk_checkpoint& checkpoint = chunk.control.checkpoints[chunk.relex_control.next_sync];
+            errors[i * 2 + 1] = chunk.errors.str().substr(checkpoint.error_size);
+            segments.push_back({ &chunk.token_stream, checkpoint.token_num, &chunk.id_list, &chunk.str_list, errors[i * 2 + 1] });
+            previous = &chunk.control;
+        }
+        else
+            previous = &chunk.relex_control;
+    }
+
+    size_t token_num = token_stream.size();
+    for (const chunk_segment& segment : segments)
+        token_num += segment.token_stream->size() - segment.first_token;
+    token_stream.reserve(token_num);
+    for (const chunk_segment& segment : segments)
+        merge_segment(segment, token_stream, id_list, str_list, word_type_num);
+    int newlines = 0;
+    for (const chunk_result& chunk : chunks)
+        newlines += chunk.newlines;
+    line_num += newlines + 1;
+    char_num += end;
+}
@@ -0,0 +1,50 @@
+﻿#pragma once
+#include <cstddef>
+#include <vector>
+#include "token.h"
+#include "token_buffer.h"
+#include "symbol_table.h"
+#include "source_buffer.h"
+
+//推测分析每产生这么多记号记录一个同步点，决定重新分析在注释结束后最多多分析多少记号
+constexpr size_t CHUNK_CHECKPOINT_INTERVAL = 256;
+
+//默认分块大小，小于两个分块的源程序直接整体分析
+constexpr size_t DEFAULT_CHUNK_SIZE = 4 << 20;
+
+//同步点：状态0开始识别新单词时的位置，以及此前已产生的记号数和错误信息长度
+struct chunk_checkpoint
+{
+    size_t pos;
+    size_t token_num;
+    size_t error_size;
+};
+
+/**
+ * 单个分块的分析控制信息，由lexer在状态0和多行注释到达分块末尾时读写
+ * 分块末尾视为EOF；重新分析到达推测分析的同步点后立即结束，此后的结果与推测分析完全相同
+ */
+struct chunk_control
+{
+    bool last_chunk = false;                                    //是否为最后一个分块，只有最后一个分块在末尾报告未结束的注释
+    int exit_state = 0;                                         //分块末尾所处的状态，0或多行注释状态23、24
+    int exit_offset = 0;                                        //分块末尾处于注释中时，注释的起始偏移
+    int entry_offset = 0;                                       //从注释状态开始分析时，注释的起始偏移
+    std::vector<chunk_checkpoint> checkpoints;                  //推测分析记录的同步点
+    size_t next_checkpoint = 0;                                 //推测分析产生这么多记号后记录下一个同步点
+    const std::vector<chunk_checkpoint>* sync_points = nullptr; //重新分析时与之比较的推测分析同步点，为nullptr表示推测分析
+    size_t next_sync = 0;                                       //重新分析尚未越过的第一个同步点
+    bool synced = false;                                        //重新分析是否已到达sync_points[next_sync]
+};
+
+/**
+ * 将单个源程序分块并行分析，结果（包括标志符表和字符串表的编号、错误信息及其顺序）与lexical_analysis完全相同
+ * 分块边界取在行首，字符常量和字符串遇到换行即结束，只有多行注释可能跨越边界
+ * 各分块先从状态0推测分析，再按顺序检查前一分块是否以注释结束，若是则从注释状态重新分析该分块，直到与推测分析同步
+ * 最后按顺序合并各分块的记号，把分块内的标志符和字符串编号重新映射为全局编号
+ * 其余参数与lexical_analysis相同
+ * int thread_num - 线程数，0表示使用硬件并发数
+ * size_t chunk_size - 分块的大致字节数
+ */
+void parallel_lexical_analysis(token_buffer& token_stream, symbol_table& id_list, symbol_table& str_list, int& line_num, std::vector<int>& word_type_num, int& char_num, source_buffer& program,
+    int thread_num, size_t chunk_size = DEFAULT_CHUNK_SIZE);
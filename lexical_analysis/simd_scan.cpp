@@ -0,0 +1,323 @@
+﻿#include "simd_scan.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SCAN_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+using namespace std;
+
+static inline int popcount(unsigned x)
+{
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    x = (x + (x >> 4)) & 0x0f0f0f0fu;
+    return (x * 0x01010101u) >> 24;
+}
+
+//x不为0
+static inline int lowest_bit(unsigned x)
+{
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, x);
+    return i;
+#else
+    return __builtin_ctz(x);
+#endif
+}
+
+//mask中低n位
+static inline unsigned low_bits(int n)
+{
+    return n >= 32 ? ~0u : (1u << n) - 1;
+}
+
+static inline bool is_identifier_char(unsigned char ch)
+{
+    unsigned char lower = ch | 0x20;
+    return (lower >= 'a' && lower <= 'z') || (ch >= '0' && ch <= '9') || ch == '_' || ch == '$';
+}
+
+static size_t scalar_skip_blank(const char* data, size_t size, int& newlines)
+{
+    size_t i = 0;
+    for (; i < size; i++)
+    {
+        if (data[i] == '\n')
+            newlines++;
+        else if (data[i] != ' ' && data[i] != '\t')
+            break;
+    }
+    return i;
+}
+
+static size_t scalar_skip_identifier(const char* data, size_t size)
+{
+    size_t i = 0;
+    while (i < size && is_identifier_char(data[i]))
+        i++;
+    return i;
+}
+
+static size_t scalar_find_line_end(const char* data, size_t size)
+{
+    size_t i = 0;
+    while (i < size && data[i] != '\n' && data[i] != (char)0xff)
+        i++;
+    return i;
+}
+
+static size_t scalar_find_comment_star(const char* data, size_t size, int& newlines)
+{
+    size_t i = 0;
+    for (; i < size; i++)
+    {
+        if (data[i] == '*' || data[i] == (char)0xff)
+            break;
+        if (data[i] == '\n')
+            newlines++;
+    }
+    return i;
+}
+
+static const scan_kernels SCALAR_KERNELS = { "scalar", scalar_skip_blank, scalar_skip_identifier, scalar_find_line_end, scalar_find_comment_star };
+
+#ifdef SCAN_X86
+
+/**
+ * SSE2与AVX2内核结构相同，只是向量宽度不同：
+ * 对每个向量求出“不满足条件”的字节掩码，第一个置位即为结果；
+ * 跳过的换行数为换行掩码在结果之前部分的位数
+ */
+
+TARGET_SSE2 static inline unsigned sse2_identifier_mask(__m128i v)
+{
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), lower));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), v));
+    __m128i other = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('_')), _mm_cmpeq_epi8(v, _mm_set1_epi8('$')));
+    return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), other));
+}
+
+TARGET_SSE2 static size_t sse2_skip_blank(const char* data, size_t size, int& newlines)
+{
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        unsigned newline = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        unsigned blank = newline | _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))));
+        unsigned stop = ~blank & 0xffff;
+        if (stop)
+        {
+            int k = lowest_bit(stop);
+            newlines += popcount(newline & low_bits(k));
+            return i + k;
+        }
+        newlines += popcount(newline);
+    }
+    return i + scalar_skip_blank(data + i, size - i, newlines);
+}
+
+TARGET_SSE2 static size_t sse2_skip_identifier(const char* data, size_t size)
+{
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        unsigned stop = ~sse2_identifier_mask(_mm_loadu_si128((const __m128i*)(data + i))) & 0xffff;
+        if (stop)
+            return i + lowest_bit(stop);
+    }
+    return i + scalar_skip_identifier(data + i, size - i);
+}
+
+TARGET_SSE2 static size_t sse2_find_line_end(const char* data, size_t size)
+{
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        unsigned stop = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8((char)0xff))));
+        if (stop)
+            return i + lowest_bit(stop);
+    }
+    return i + scalar_find_line_end(data + i, size - i);
+}
+
+TARGET_SSE2 static size_t sse2_find_comment_star(const char* data, size_t size, int& newlines)
+{
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        unsigned newline = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        unsigned stop = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('*')), _mm_cmpeq_epi8(v, _mm_set1_epi8((char)0xff))));
+        if (stop)
+        {
+            int k = lowest_bit(stop);
+            newlines += popcount(newline & low_bits(k));
+            return i + k;
+        }
+        newlines += popcount(newline);
+    }
+    return i + scalar_find_comment_star(data + i, size - i, newlines);
+}
+
+TARGET_AVX2 static inline unsigned avx2_identifier_mask(__m256i v)
+{
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+    __m256i other = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('$')));
+    return _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(alpha, digit), other));
+}
+
+TARGET_AVX2 static size_t avx2_skip_blank(const char* data, size_t size, int& newlines)
+{
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+        unsigned newline = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+        unsigned blank = newline | _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))));
+        unsigned stop = ~blank;
+        if (stop)
+        {
+            int k = lowest_bit(stop);
+            newlines += popcount(newline & low_bits(k));
+            return i + k;
+        }
+        newlines += popcount(newline);
+    }
+    return i + sse2_skip_blank(data + i, size - i, newlines);
+}
+
+TARGET_AVX2 static size_t avx2_skip_identifier(const char* data, size_t size)
+{
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        unsigned stop = ~avx2_identifier_mask(_mm256_loadu_si256((const __m256i*)(data + i)));
+        if (stop)
+            return i + lowest_bit(stop);
+    }
+    return i + sse2_skip_identifier(data + i, size - i);
+}
+
+TARGET_AVX2 static size_t avx2_find_line_end(const char* data, size_t size)
+{
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+        unsigned stop = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8((char)0xff))));
+        if (stop)
+            return i + lowest_bit(stop);
+    }
+    return i + sse2_find_line_end(data + i, size - i);
+}
+
+TARGET_AVX2 static size_t avx2_find_comment_star(const char* data, size_t size, int& newlines)
+{
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+        unsigned newline = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+        unsigned stop = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('*')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8((char)0xff))));
+        if (stop)
+        {
+            int k = lowest_bit(stop);
+            newlines += popcount(newline & low_bits(k));
+            return i + k;
+        }
+        newlines += popcount(newline);
+    }
+    return i + sse2_find_comment_star(data + i, size - i, newlines);
+}
+
+static const scan_kernels SSE2_KERNELS = { "sse2", sse2_skip_blank, sse2_skip_identifier, sse2_find_line_end, sse2_find_comment_star };
+static const scan_kernels AVX2_KERNELS = { "avx2", avx2_skip_blank, avx2_skip_identifier, avx2_find_line_end, avx2_find_comment_star };
+
+static bool cpu_has_sse2()
+{
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 1);
+    return (regs[3] >> 26) & 1;
+#else
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+static bool cpu_has_avx2()
+{
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 0);
+    if (regs[0] < 7)
+        return false;
+    __cpuid(regs, 1);
+    bool osxsave = (regs[2] >> 27) & 1;
+    bool avx = (regs[2] >> 28) & 1;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) //操作系统需保存YMM寄存器
+        return false;
+    __cpuidex(regs, 7, 0);
+    return (regs[1] >> 5) & 1;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+static const scan_kernels* detect_scan_kernels()
+{
+#ifdef SCAN_X86
+#ifndef _MSC_VER
+    __builtin_cpu_init(); //在静态初始化阶段调用，需先初始化CPU信息
+#endif
+    if (cpu_has_avx2())
+        return &AVX2_KERNELS;
+    if (cpu_has_sse2())
+        return &SSE2_KERNELS;
+#endif
+    return &SCALAR_KERNELS;
+}
+
+const scan_kernels* scan = detect_scan_kernels();
+
+bool select_scan_kernels(const char* name)
+{
+    if (strcmp(name, "scalar") == 0)
+    {
+        scan = &SCALAR_KERNELS;
+        return true;
+    }
+#ifdef SCAN_X86
+    if (strcmp(name, "sse2") == 0 && cpu_has_sse2())
+    {
+        scan = &SSE2_KERNELS;
+        return true;
+    }
+    if (strcmp(name, "avx2") == 0 && cpu_has_avx2())
+    {
+        scan = &AVX2_KERNELS;
+        return true;
+    }
+#endif
+    return false;
+}
@@ -0,0 +1,30 @@
+﻿#pragma once
+#include <cstddef>
+
+/**
+ * 整块扫描源程序的内核，每次处理16（SSE2）或32（AVX2）个字节
+ * 各函数返回从data开始第一个不满足条件的字节的偏移，全部满足时返回size
+ * 值为0xff的字节与词法分析器中的EOF相同，各函数都会在其前停下
+ */
+struct scan_kernels
+{
+    const char* name;
+
+    //跳过空格、制表符和换行，newlines累加跳过的换行数
+    size_t (*skip_blank)(const char* data, size_t size, int& newlines);
+
+    //跳过标志符字符：字母、数字、下划线_、美元符号$
+    size_t (*skip_identifier)(const char* data, size_t size);
+
+    //查找单行注释的结尾：换行或0xff
+    size_t (*find_line_end)(const char* data, size_t size);
+
+    //查找多行注释中下一个'*'或0xff，newlines累加跳过的换行数
+    size_t (*find_comment_star)(const char* data, size_t size, int& newlines);
+};
+
+//当前使用的扫描内核，程序启动时根据CPUID选择AVX2、SSE2或标量实现
+extern const scan_kernels* scan;
+
+//按名称（scalar、sse2、avx2）选择扫描内核，CPU不支持或名称不存在时返回false
+bool select_scan_kernels(const char* name);
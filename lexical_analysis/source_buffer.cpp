@@ -0,0 +1,82 @@
+﻿#include "source_buffer.h"
+#include <fstream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+source_buffer::~source_buffer()
+{
+    close_source(*this);
+}
+
+#ifndef _WIN32
+//使用mmap映射整个文件，空文件无法映射，直接视为长度为0的缓冲区
+static bool map_source(source_buffer& src, const string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0)
+    {
+        close(fd);
+        src.data = "";
+        src.size = 0;
+        return true;
+    }
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        return false;
+    madvise(addr, st.st_size, MADV_SEQUENTIAL);
+    src.data = (const char*)addr;
+    src.size = st.st_size;
+    src.mapped = true;
+    return true;
+}
+#endif
+
+bool open_source(source_buffer& src, const string& path)
+{
+    close_source(src);
+#ifndef _WIN32
+    if (map_source(src, path))
+        return true;
+#endif
+    //以文本方式读入，保证与ifstream逐字符读取时的换行处理一致
+    ifstream program(path, ios::in);
+    if (!program)
+        return false;
+    ostringstream ostr;
+    ostr << program.rdbuf();
+    src.storage = ostr.str();
+    src.data = src.storage.data();
+    src.size = src.storage.size();
+    return true;
+}
+
+void close_source(source_buffer& src)
+{
+#ifndef _WIN32
+    if (src.mapped)
+        munmap((void*)src.data, src.size);
+#endif
+    src.storage.clear();
+    src.data = nullptr;
+    src.size = 0;
+    src.pos = 0;
+    src.lexeme_begin = src.lexeme_end = 0;
+    src.mapped = false;
+}
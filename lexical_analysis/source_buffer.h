@@ -0,0 +1,34 @@
+﻿#pragma once
+#include <cstddef>
+#include <string>
+
+/**
+ * 整块载入内存的源程序
+ * Linux下使用mmap将文件映射到内存，其他平台一次性读入连续缓冲区
+ * 词法分析器通过pos游标逐字符读取，回退只需pos--
+ */
+struct source_buffer
+{
+    const char* data = nullptr;     //源程序首地址
+    size_t size = 0;                //源程序字节数
+    size_t pos = 0;                 //当前读取位置，读到EOF后仍会递增，以便retract正确回退
+    size_t lexeme_begin = 0;        //当前单词的起始位置
+    size_t lexeme_end = 0;          //当前单词的结束位置（不含）
+    bool mapped = false;            //data是否为mmap映射得到
+    std::string storage;            //非映射方式下保存文件内容
+
+    source_buffer() = default;
+    source_buffer(const source_buffer&) = delete;
+    source_buffer& operator=(const source_buffer&) = delete;
+    ~source_buffer();
+};
+
+/**
+ * 打开源程序并载入内存，成功返回true
+ * source_buffer& src - 需要载入的缓冲区
+ * const std::string& path - 源程序路径
+ */
+bool open_source(source_buffer& src, const std::string& path);
+
+//释放缓冲区占用的内存或映射
+void close_source(source_buffer& src);
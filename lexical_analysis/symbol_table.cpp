@@ -0,0 +1,103 @@
+﻿#include "symbol_table.h"
+#include "lexer_profile.h"
+#include <cstring>
+
+using namespace std;
+
+const size_t INITIAL_SLOT_NUM = 64;
+
+symbol_table::symbol_table() : slots(INITIAL_SLOT_NUM, -1), mask(INITIAL_SLOT_NUM - 1)
+{
+}
+
+//FNV-1a哈希
+uint32_t symbol_table::hash(string_view str)
+{
+    uint32_t h = 2166136261u;
+    for (unsigned char ch : str)
+    {
+        h ^= ch;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+int symbol_table::find(string_view str) const
+{
+    uint32_t h = hash(str);
+    for (size_t i = h & mask; ; i = (i + 1) & mask)
+    {
+        int entry = slots[i];
+        if (entry == -1)
+            return -1;
+        if (hashes[entry] == h && lengths[entry] == str.size() && memcmp(text.data(offsets[entry]), str.data(), str.size()) == 0)
+            return entry;
+    }
+}
+
+int symbol_table::insert(string_view str, uint32_t occurrences)
+{
+    uint32_t h = hash(str);
+    size_t i = h & mask;
+    for (; ; i = (i + 1) & mask)
+    {
+        int entry = slots[i];
+        if (entry == -1)
+            break;
+        if (hashes[entry] == h && lengths[entry] == str.size() && memcmp(text.data(offsets[entry]), str.data(), str.size()) == 0)
+        {
+            PROFILE_PROBES(((i - h) & mask) + 1);
+            counts[entry] += occurrences;
+            return entry;
+        }
+    }
+    PROFILE_PROBES(((i - h) & mask) + 1);
+
+    int entry = offsets.size();
+    offsets.push_back(text.store(str));
+    lengths.push_back(str.size());
+    hashes.push_back(h);
+    counts.push_back(occurrences);
+    slots[i] = entry;
+
+    //装载因子超过1/2时扩容
+    if (offsets.size() * 2 > slots.size())
+        grow();
+    return entry;
+}
+
+void symbol_table::grow()
+{
+    slots.assign(slots.size() * 2, -1);
+    mask = slots.size() - 1;
+    for (int entry = 0; entry < (int)hashes.size(); entry++)
+    {
+        size_t i = hashes[entry] & mask;
+        while (slots[i] != -1)
+            i = (i + 1) & mask;
+        slots[i] = entry;
+    }
+}
+
+void symbol_table::clear()
+{
+    //分析过大文件后表中只剩少量表项时，只清除用到的槽，避免每次清空都写整个槽数组
+    if (hashes.size() * 8 < slots.size())
+    {
+        for (int entry = 0; entry < (int)hashes.size(); entry++)
+        {
+            size_t i = hashes[entry] & mask;
+            while (slots[i] != entry)
+                i = (i + 1) & mask;
+            slots[i] = -1;
+        }
+    }
+    else
+        slots.assign(slots.size(), -1);
+    text.clear();
+    offsets.clear();
+    lengths.clear();
+    hashes.clear();
+    counts.clear();
+    keyword_counts.fill(0);
+}
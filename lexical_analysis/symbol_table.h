@@ -0,0 +1,68 @@
+﻿#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "keyword.h"
+#include "text_arena.h"
+
+/**
+ * 符号表（标志符表、字符串表）
+ * 使用开放定址的哈希表查找，表项内容依次存放在表自己的文本区中，表中只保存其位置；表增长时已有的内容不会被移动
+ * 表中的全部文本随表一次释放，表随词法分析的使用者（一次分析、一个工作线程）存在
+ * 表项编号按插入顺序从0开始分配，插入后不再改变
+ * 插入时同时累计表项的出现次数，词法分析结束后即为各标志符、字符串在记号流中的出现次数，统计不需要再遍历记号流
+ * 关键字不插入表中，但在识别关键字时同样计入标志符表的关键字次数
+ */
+class symbol_table
+{
+public:
+    symbol_table();
+
+    symbol_table(const symbol_table&) = delete;
+    symbol_table& operator=(const symbol_table&) = delete;
+
+    //查找str在表中的编号，若不存在则插入到表格末尾，返回其编号；表项的出现次数加上occurrences
+    int insert(std::string_view str, uint32_t occurrences = 1);
+
+    //查找str在表中的编号，若不存在返回-1
+    int find(std::string_view str) const;
+
+    //按编号取出表项
+    std::string_view operator[](size_t i) const { return std::string_view(text.data(offsets[i]), lengths[i]); }
+
+    size_t size() const { return offsets.size(); }
+
+    //第i个表项的出现次数
+    uint32_t count(size_t i) const { return counts[i]; }
+
+    //调整第i个表项的出现次数，用于合并或重新映射符号表以及增量分析撤销旧记号
+    void add_count(size_t i, int delta) { counts[i] += delta; }
+
+    //关键字（KEYWORD_NAMES中的下标）的出现次数
+    uint32_t keyword_count(int keyword) const { return keyword_counts[keyword]; }
+    void add_keyword_count(int keyword, int delta = 1) { keyword_counts[keyword] += delta; }
+
+    //清空表项，保留已分配的空间
+    void clear();
+
+    //表项内容所在的文本区
+    const text_arena& get_text() const { return text; }
+
+    //表项的哈希值（FNV-1a），concurrent_symbol_table使用同一哈希
+    static uint32_t hash(std::string_view str);
+
+private:
+    void grow();
+
+    text_arena text;                //所有表项的内容，按插入顺序存放
+    std::vector<uint32_t> offsets;  //表项在text中的位置
+    std::vector<uint32_t> lengths;  //表项长度
+    std::vector<uint32_t> hashes;   //表项的哈希值，扩容时无需重新计算
+    std::vector<uint32_t> counts;   //表项的出现次数
+    std::array<uint32_t, KEYWORD_AMOUNT> keyword_counts{};  //各关键字的出现次数
+    std::vector<int> slots;         //哈希槽，保存表项编号，-1表示空槽
+    size_t mask;                    //slots.size() - 1，slots大小始终为2的幂
+};
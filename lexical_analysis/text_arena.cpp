@@ -0,0 +1,52 @@
+﻿#include "text_arena.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+using namespace std;
+
+uint32_t text_arena::store(string_view str)
+{
+    //当前块已满时即使str为空也换新块，否则位置中的块内偏移会等于块大小
+    if (str.size() > left || left == 0)
+        add_block(str.size());
+    //块内偏移须小于块大小上限，否则会进位到块号中
+    assert(top < ARENA_BLOCK_SIZE);
+    uint32_t position = (uint32_t)(((blocks.size() - 1) << ARENA_BLOCK_BITS) | top);
+    memcpy(blocks.back().data.get() + top, str.data(), str.size());
+    top += str.size();
+    left -= str.size();
+    used += str.size();
+    return position;
+}
+
+void text_arena::add_block(size_t min_size)
+{
+    size_t size = max(next_block_size, min_size);
+    blocks.push_back({ unique_ptr<char[]>(new char[size]), size });
+    top = 0;
+    left = size;
+    next_block_size = min(next_block_size * 2, ARENA_BLOCK_SIZE);
+}
+
+void text_arena::clear()
+{
+    used = 0;
+    top = 0;
+    left = 0;
+    //超过ARENA_BLOCK_SIZE的块只能从偏移0起存放一段文本，不能保留，否则之后的偏移会超出块内偏移的位数
+    auto largest = blocks.end();
+    for (auto it = blocks.begin(); it != blocks.end(); ++it)
+    {
+        if (it->size <= ARENA_BLOCK_SIZE && (largest == blocks.end() || it->size > largest->size))
+            largest = it;
+    }
+    if (largest == blocks.end())
+    {
+        blocks.clear();
+        return;
+    }
+    swap(blocks.front(), *largest);
+    blocks.resize(1);
+    left = blocks.front().size;
+}
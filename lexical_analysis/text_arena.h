@@ -0,0 +1,53 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+//文本的位置由块号和块内偏移组成，块内偏移占ARENA_BLOCK_BITS位，可以用32位保存
+constexpr int ARENA_BLOCK_BITS = 20;
+
+//第一块的大小，之后每块加倍，直到2^ARENA_BLOCK_BITS字节
+constexpr size_t ARENA_FIRST_BLOCK_SIZE = 4096;
+constexpr size_t ARENA_BLOCK_SIZE = (size_t)1 << ARENA_BLOCK_BITS;
+
+/**
+ * 按块分配的文本区（bump-pointer arena），保存符号表中的标志符和字符串
+ * 文本依次追加在当前块末尾，块满时分配新块，已保存的文本不会被移动或复制，地址在文本区清空前一直有效；
+ * 超过当前块大小的文本单独占用一块；文本不能单独释放，只能随文本区一次清空或释放
+ */
+class text_arena
+{
+public:
+    text_arena() = default;
+    text_arena(const text_arena&) = delete;
+    text_arena& operator=(const text_arena&) = delete;
+
+    //复制str到文本区，返回其位置
+    uint32_t store(std::string_view str);
+
+    //位置对应的地址
+    const char* data(uint32_t position) const { return blocks[position >> ARENA_BLOCK_BITS].data.get() + (position & (ARENA_BLOCK_SIZE - 1)); }
+
+    //清空文本，保留不超过ARENA_BLOCK_SIZE的最大一块供之后使用
+    void clear();
+
+    size_t size() const { return used; }                //已保存的字节数
+    size_t block_count() const { return blocks.size(); }
+
+private:
+    struct block
+    {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    void add_block(size_t min_size);
+
+    std::vector<block> blocks;
+    size_t top = 0;                 //当前块中下一个可用位置
+    size_t left = 0;                //当前块剩余的字节数
+    size_t next_block_size = ARENA_FIRST_BLOCK_SIZE;
+    size_t used = 0;
+};
@@ -0,0 +1,97 @@
+﻿#include "thread_pool.h"
+
+using namespace std;
+
+thread_pool::thread_pool(int thread_num) : queued(0), next_queue(0)
+{
+    if (thread_num <= 0)
+        thread_num = thread::hardware_concurrency();
+    if (thread_num <= 0)
+        thread_num = 1;
+    for (int i = 0; i < thread_num; i++)
+        queues.push_back(make_unique<worker_queue>());
+    for (int i = 0; i < thread_num; i++)
+        threads.emplace_back(&thread_pool::run, this, i);
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    task_ready.notify_all();
+    for (thread& t : threads)
+        t.join();
+}
+
+void thread_pool::submit(task t)
+{
+    //先计数再入队，保证计数不会因任务被立即取走而暂时为负
+    {
+        lock_guard<std::mutex> lock(mutex);
+        unfinished++;
+        queued++;
+    }
+    worker_queue& queue = *queues[next_queue++ % queues.size()];
+    {
+        lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(move(t));
+    }
+    task_ready.notify_one();
+}
+
+void thread_pool::wait()
+{
+    unique_lock<std::mutex> lock(mutex);
+    all_done.wait(lock, [this] { return unfinished == 0; });
+}
+
+//从自己队列的队尾取任务
+bool thread_pool::pop(int id, task& t)
+{
+    worker_queue& queue = *queues[id];
+    lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+        return false;
+    t = move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+//从其他线程队列的队首窃取任务
+bool thread_pool::steal(int id, task& t)
+{
+    for (size_t i = 1; i < queues.size(); i++)
+    {
+        worker_queue& queue = *queues[(id + i) % queues.size()];
+        lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+        t = move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void thread_pool::run(int id)
+{
+    while (true)
+    {
+        task t;
+        if (pop(id, t) || steal(id, t))
+        {
+            queued--;
+            t(id);
+            lock_guard<std::mutex> lock(mutex);
+            if (--unfinished == 0)
+                all_done.notify_all();
+            continue;
+        }
+        unique_lock<std::mutex> lock(mutex);
+        task_ready.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0)
+            return;
+    }
+}
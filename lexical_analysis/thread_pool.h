@@ -0,0 +1,56 @@
+﻿#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * 工作窃取线程池
+ * 每个工作线程有自己的任务队列，从队尾取任务；自己的队列为空时从其他线程的队首窃取
+ * 任务的参数为执行它的工作线程编号（0 ~ size()-1），便于任务使用线程私有的数据
+ */
+class thread_pool
+{
+public:
+    using task = std::function<void(int)>;
+
+    //thread_num为0时使用硬件并发数
+    explicit thread_pool(int thread_num = 0);
+    ~thread_pool();
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    int size() const { return (int)threads.size(); }
+
+    //提交任务，任务轮流放入各线程的队列
+    void submit(task t);
+
+    //等待已提交的任务全部完成
+    void wait();
+
+private:
+    struct worker_queue
+    {
+        std::mutex mutex;
+        std::deque<task> tasks;
+    };
+
+    void run(int id);
+    bool pop(int id, task& t);
+    bool steal(int id, task& t);
+
+    std::vector<std::unique_ptr<worker_queue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex mutex;                       //保护下面的计数和stopping，供线程休眠和唤醒
+    std::condition_variable task_ready;
+    std::condition_variable all_done;
+    std::atomic<size_t> queued;             //队列中尚未取出的任务数
+    size_t unfinished = 0;                  //已提交但尚未完成的任务数
+    bool stopping = false;
+    std::atomic<size_t> next_queue;        //下一个任务放入的队列
+};
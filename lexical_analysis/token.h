@@ -0,0 +1,85 @@
+﻿#pragma once
+
+const int WORD_TYPE_AMOUNT = 40; // word_type数量，不包含注释和具体的关系运算符和赋值运算符
+enum word_type
+{
+    KEYWORD,                    //关键字
+    ID,                         //标志符
+    STRING,                     //字符串常量
+    CHAR,                       //字符常量
+    INT,                        //整型常量
+    UINT,                       //无符号整型常量
+    LONG,                       //长整型常量
+    ULONG,                      //无符号长整型
+    FLOAT,                      //单精度浮点数
+    DOUBLE,                     //双精度浮点数
+    RELATION_OPERATOR,          //关系运算符
+    ASSIGN_OPERATOR,            //赋值运算符
+    PLUS,                       //"+"
+    MINUS,                      //"-"
+    MULTIPLY,                   //"*"
+    DIVIDE,                     //"/"
+    MOD,                        //"%"
+    INC,                        //"++"
+    DEC,                        //"--"
+    LOGICAL_AND,                //"&&"
+    LOGICAL_OR,                 //"||"
+    LOGICAL_NEGATION,           //"!"
+    BITWISE_AND,                //"&"
+    BITWISE_OR,                 //"|"
+    BITWISE_NEGATION,           //"~"
+    BITWISE_XOR,                //"^"
+    BITWISE_LSHIFT,             //"<<"
+    BITWISE_RSHIFT,             //">>"
+    QUESTION_MARK,              //"?"
+    COLON,                      //":"
+    SEMICOLON,                  //";"
+    LEFT_SQUARE_BRACKET,        //"["
+    RIGHT_SQUARE_BRACKET,       //"]"
+    LEFT_PARENTHESE,            //"("
+    RIGHT_PARENTHESE,           //")"
+    LEFT_BRACE,                 //"{"
+    RIGHT_BRACE,                //"}"
+    DOT,                        //"."
+    COMMA,                      //","
+    ARROW,                      //"->"
+    ANNOTATION,                  //注释
+
+    //关系运算符属性
+    GREATER,                    //">"
+    GREATER_EQUAL,              //">="
+    LESS,                       //"<"
+    LESS_EQUAL,                 //"<="
+    EQUAL,                      //"=="
+    UNEQUAL,                    //"!="
+
+    //赋值运算符属性
+    SIMPLE_EQUAL,               //"="
+    PLUS_EQUAL,                 //"+="
+    MINUS_EQUAL,                //"-="
+    MULTIPLY_EQUAL,             //"*="
+    DIVIDE_EQUAL,               //"/="
+    MOD_EQUAL,                  //"%="
+    AND_EQUAL,                  //"&="
+    OR_EQUAL,                   //"|="
+    XOR_EQUAL,                  //"^="
+    LSHIFT_EQUAL,               //"<<="
+    RSHIFT_EQUAL,               //">>="
+};
+
+union value_type
+{
+    int i;
+    unsigned int ui;
+    long l;
+    unsigned long int ul;
+    unsigned char c;
+    float f;
+    double d;
+};
+
+struct token
+{
+    word_type type;
+    value_type value;
+};
@@ -0,0 +1,150 @@
+﻿#include "token_buffer.h"
+#include <algorithm>
+
+using namespace std;
+
+const size_t BLOCK_SIZE = 64;
+
+void token_buffer::push_back(const struct token& token, uint32_t offset, uint32_t length)
+{
+    if (kinds.size() % BLOCK_SIZE == 0)
+        blocks.push_back({ (uint32_t)indices.size(), (uint32_t)values.size() });
+    uint8_t kind = token.type;
+    if (token.type == RELATION_OPERATOR || token.type == ASSIGN_OPERATOR)
+        kind = token.value.i;
+    else if (has_index(kind))
+        indices.push_back(token.value.i);
+    else if (has_value(kind))
+        values.push_back(token.value);
+    kinds.push_back(kind);
+    offsets.push_back(offset);
+    lengths.push_back(length);
+}
+
+void token_buffer::clear()
+{
+    kinds.clear();
+    offsets.clear();
+    lengths.clear();
+    indices.clear();
+    values.clear();
+    blocks.clear();
+}
+
+void token_buffer::reserve(size_t n)
+{
+    kinds.reserve(n);
+    offsets.reserve(n);
+    lengths.reserve(n);
+    indices.reserve(n);
+    blocks.reserve(n / BLOCK_SIZE + 1);
+}
+
+//把v的[first, last)替换为src的[src_first, src_last)，只移动一次其后的元素
+template <class T>
+static void splice(vector<T>& v, size_t first, size_t last, const vector<T>& src, size_t src_first, size_t src_last)
+{
+    size_t n = src_last - src_first;
+    if (n > last - first)
+        v.insert(v.begin() + last, n - (last - first), T());
+    else if (n < last - first)
+        v.erase(v.begin() + first + n, v.begin() + last);
+    copy(src.begin() + src_first, src.begin() + src_last, v.begin() + first);
+}
+
+void token_buffer::replace(size_t first, size_t last, const token_buffer& tokens, int64_t delta)
+{
+    const_iterator from = iterator_at(first), to = iterator_at(last);
+    size_t n = tokens.size();
+    splice(indices, from.index, to.index, tokens.indices, 0, tokens.indices.size());
+    splice(values, from.value, to.value, tokens.values, 0, tokens.values.size());
+    splice(kinds, first, last, tokens.kinds, 0, n);
+    splice(offsets, first, last, tokens.offsets, 0, n);
+    splice(lengths, first, last, tokens.lengths, 0, n);
+    for (size_t i = first + n; i < offsets.size(); i++)
+        offsets[i] += (uint32_t)delta;
+
+    //从first起重新计数各块之前的编号数和常量数；记号数不变时块的边界不变，last所在的块之后只需整体调整
+    size_t block_num = (kinds.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    size_t recount_end = n == last - first ? min(last / BLOCK_SIZE + 1, block_num) : block_num;
+    blocks.resize(block_num);
+    uint32_t index = (uint32_t)from.index;
+    uint32_t value = (uint32_t)from.value;
+    for (size_t j = first; j < kinds.size() && j / BLOCK_SIZE < recount_end; j++)
+    {
+        if (j % BLOCK_SIZE == 0)
+            blocks[j / BLOCK_SIZE] = { index, value };
+        index += has_index(kinds[j]);
+        value += has_value(kinds[j]);
+    }
+    uint32_t index_delta = (uint32_t)(tokens.indices.size() - (to.index - from.index));
+    uint32_t value_delta = (uint32_t)(tokens.values.size() - (to.value - from.value));
+    for (size_t i = recount_end; i < block_num; i++)
+    {
+        blocks[i].index += index_delta;
+        blocks[i].value += value_delta;
+    }
+}
+
+word_type token_buffer::type(size_t i) const
+{
+    uint8_t kind = kinds[i];
+    if (kind >= GREATER && kind <= UNEQUAL)
+        return RELATION_OPERATOR;
+    if (kind >= SIMPLE_EQUAL)
+        return ASSIGN_OPERATOR;
+    return (word_type)kind;
+}
+
+struct token token_buffer::operator[](size_t i) const
+{
+    return *iterator_at(i);
+}
+
+token_buffer::const_iterator token_buffer::begin() const
+{
+    return const_iterator(this, 0, 0, 0);
+}
+
+token_buffer::const_iterator token_buffer::end() const
+{
+    return const_iterator(this, kinds.size(), indices.size(), values.size());
+}
+
+//从第i个记号所在块的起点开始，数出其之前的编号数和常量数
+token_buffer::const_iterator token_buffer::iterator_at(size_t i) const
+{
+    if (i >= kinds.size())
+        return end();
+    const block_start& block = blocks[i / BLOCK_SIZE];
+    size_t index = block.index;
+    size_t value = block.value;
+    for (size_t j = i - i % BLOCK_SIZE; j < i; j++)
+    {
+        index += has_index(kinds[j]);
+        value += has_value(kinds[j]);
+    }
+    return const_iterator(this, i, index, value);
+}
+
+size_t token_buffer::memory_usage() const
+{
+    return kinds.size() * sizeof(uint8_t) + offsets.size() * sizeof(uint32_t) + lengths.size() * sizeof(uint32_t)
+        + indices.size() * sizeof(uint32_t) + values.size() * sizeof(value_type) + blocks.size() * sizeof(block_start);
+}
+
+struct token token_buffer::const_iterator::operator*() const
+{
+    struct token token;
+    uint8_t kind = buffer->kinds[pos];
+    token.type = buffer->type(pos);
+    if (token.type == RELATION_OPERATOR || token.type == ASSIGN_OPERATOR)
+        token.value.i = kind;
+    else if (has_index(kind))
+        token.value.i = buffer->indices[index];
+    else if (has_value(kind))
+        token.value = buffer->values[value];
+    else
+        token.value.d = 0;
+    return token;
+}
@@ -0,0 +1,104 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "token.h"
+
+/**
+ * 按列存放的记号流
+ * 每个记号只占1字节种类、4字节起始位置和4字节长度；关键字、标志符和字符串的编号存在4字节的编号表中，
+ * 只有常量的值存在8字节的附表中；关系运算符和赋值运算符直接以具体的运算符作为种类
+ * 记号的位置是其在源程序中的字节偏移，需要行号和列号时再由偏移计算
+ */
+class token_buffer
+{
+public:
+    class const_iterator;
+
+    //加入一个记号，offset和length为其在源程序中的位置和长度
+    void push_back(const struct token& token, uint32_t offset, uint32_t length);
+
+    size_t size() const { return kinds.size(); }
+    bool empty() const { return kinds.empty(); }
+
+    //清空记号，保留已分配的空间
+    void clear();
+
+    //为n个记号预留空间，编号表按全部记号都带编号预留
+    void reserve(size_t n);
+
+    /**
+     * 把第[first, last)个记号替换为tokens中的全部记号，之后的记号在源程序中的偏移加上delta，用于增量分析
+     * 替换前后记号数相同时不移动其余记号
+     */
+    void replace(size_t first, size_t last, const token_buffer& tokens, int64_t delta);
+
+    //第i个记号的类型
+    word_type type(size_t i) const;
+
+    //第i个记号在源程序中的字节偏移和长度
+    uint32_t offset(size_t i) const { return offsets[i]; }
+    uint32_t length(size_t i) const { return lengths[i]; }
+
+    //还原第i个完整记号，编号和常量值需在编号表和附表中定位，顺序访问时应使用迭代器
+    struct token operator[](size_t i) const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    //指向第i个记号的迭代器
+    const_iterator iterator_at(size_t i) const;
+
+    //已使用的字节数，不含预留空间
+    size_t memory_usage() const;
+
+    //该种类的记号是否在编号表中带有编号（关键字、标志符、字符串）
+    static bool has_index(uint8_t kind) { return kind <= STRING; }
+
+    //该种类的记号是否在附表中带有常量值
+    static bool has_value(uint8_t kind) { return kind >= CHAR && kind <= DOUBLE; }
+
+private:
+    //每BLOCK_SIZE个记号之前的编号数和常量数，用于随机访问
+    struct block_start
+    {
+        uint32_t index;
+        uint32_t value;
+    };
+
+    std::vector<uint8_t> kinds;             //记号种类，关系运算符和赋值运算符为具体的运算符
+    std::vector<uint32_t> offsets;          //记号在源程序中的字节偏移
+    std::vector<uint32_t> lengths;          //记号的字节长度
+    std::vector<uint32_t> indices;          //关键字、标志符和字符串的编号，按记号顺序存放
+    std::vector<value_type> values;         //常量的值，按记号顺序存放
+    std::vector<block_start> blocks;
+};
+
+//顺序访问记号流，同时记录编号表和附表中的位置
+class token_buffer::const_iterator
+{
+public:
+    const_iterator(const token_buffer* buffer, size_t pos, size_t index, size_t value) : buffer(buffer), pos(pos), index(index), value(value) {}
+
+    struct token operator*() const;
+    const_iterator& operator++()
+    {
+        uint8_t kind = buffer->kinds[pos];
+        index += has_index(kind);
+        value += has_value(kind);
+        pos++;
+        return *this;
+    }
+    bool operator==(const const_iterator& other) const { return pos == other.pos; }
+    bool operator!=(const const_iterator& other) const { return pos != other.pos; }
+
+    size_t position() const { return pos; }     //当前记号的下标
+
+private:
+    friend class token_buffer;
+
+    const token_buffer* buffer;
+    size_t pos;
+    size_t index;
+    size_t value;
+};
@@ -0,0 +1,369 @@
+﻿#include "token_file.h"
+#include "keyword.h"
+#include "varint.h"
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+static uint64_t zigzag(int64_t value) { return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); }
+
+static int64_t unzigzag(uint64_t value) { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+
+//按小端写入bits的低bytes个字节，与主机字节序无关
+static void put_fixed(string& out, uint64_t bits, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        out.push_back((char)(bits >> (i * 8)));
+}
+
+static bool get_fixed(const char*& pos, const char* end, uint64_t& bits, int bytes)
+{
+    if (end - pos < bytes)
+        return false;
+    bits = 0;
+    for (int i = 0; i < bytes; i++)
+        bits |= (uint64_t)(unsigned char)pos[i] << (i * 8);
+    pos += bytes;
+    return true;
+}
+
+//读取不超过limit的变长整数
+static inline bool get_count(const char*& pos, const char* end, uint64_t limit, uint64_t& value)
+{
+    return get_varint(pos, end, value) && value <= limit;
+}
+
+static bool valid_kind(uint64_t kind)
+{
+    return (kind <= ARROW && kind != RELATION_OPERATOR && kind != ASSIGN_OPERATOR) || (kind >= GREATER && kind <= RSHIFT_EQUAL);
+}
+
+static void put_table(string& out, const symbol_table& table)
+{
+    put_varint(out, table.size());
+    for (size_t i = 0; i < table.size(); i++)
+    {
+        string_view entry = table[i];
+        put_varint(out, entry.size());
+        out.append(entry);
+    }
+}
+
+static bool get_table(const char*& pos, const char* end, vector<string_view>& table)
+{
+    uint64_t count;
+    if (!get_count(pos, end, end - pos, count))
+        return false;
+    table.clear();
+    table.reserve(count);
+    for (uint64_t i = 0; i < count; i++)
+    {
+        uint64_t length;
+        if (!get_count(pos, end, end - pos, length))
+            return false;
+        table.emplace_back(pos, length);
+        pos += length;
+    }
+    return true;
+}
+
+void encode_token_file(string& out, const token_buffer& token_stream, const symbol_table& id_list, const symbol_table& str_list,
+    int line_num, const vector<int>& word_type_num, int char_num, const vector<lexical_error>& errors)
+{
+    out.append(TOKEN_FILE_MAGIC, sizeof(TOKEN_FILE_MAGIC));
+    put_fixed(out, TOKEN_FILE_VERSION, 4);
+    put_varint(out, word_type_num.size());
+    put_varint(out, line_num);
+    put_varint(out, char_num);
+    put_varint(out, token_stream.size());
+    for (int num : word_type_num)
+        put_varint(out, num);
+    put_table(out, id_list);
+    put_table(out, str_list);
+    put_varint(out, errors.size());
+    for (const lexical_error& error : errors)
+    {
+        put_varint(out, error.offset);
+        put_varint(out, error.word.size());
+        out.append(error.word);
+    }
+
+    uint32_t end_offset = 0;
+    token_buffer::const_iterator it = token_stream.begin();
+    for (size_t i = 0; i < token_stream.size(); i++, ++it)
+    {
+        struct token token = *it;
+        uint32_t offset = token_stream.offset(i);
+        uint32_t length = token_stream.length(i);
+        bool is_operator = token.type == RELATION_OPERATOR || token.type == ASSIGN_OPERATOR;
+        put_varint(out, is_operator ? token.value.i : token.type);
+        put_varint(out, zigzag((int64_t)offset - end_offset));
+        put_varint(out, length);
+        end_offset = offset + length;
+        switch (token.type)
+        {
+        case KEYWORD:
+        case ID:
+        case STRING:
+        case UINT:
+            put_varint(out, token.value.ui);
+            break;
+        case CHAR:
+            out.push_back((char)token.value.c);
+            break;
+        case INT:
+            put_varint(out, zigzag(token.value.i));
+            break;
+        case LONG:
+            put_varint(out, zigzag(token.value.l));
+            break;
+        case ULONG:
+            put_varint(out, token.value.ul);
+            break;
+        case FLOAT:
+        {
+            uint32_t bits;
+            memcpy(&bits, &token.value.f, sizeof(bits));
+            put_fixed(out, bits, 4);
+            break;
+        }
+        case DOUBLE:
+        {
+            uint64_t bits;
+            memcpy(&bits, &token.value.d, sizeof(bits));
+            put_fixed(out, bits, 8);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+bool write_token_file(const string& path, const token_buffer& token_stream, const symbol_table& id_list, const symbol_table& str_list,
+    int line_num, const vector<int>& word_type_num, int char_num, const vector<lexical_error>& errors)
+{
+    string out;
+    encode_token_file(out, token_stream, id_list, str_list, line_num, word_type_num, char_num, errors);
+    ofstream file(path, ios::out | ios::binary | ios::trunc);
+    if (!file)
+        return false;
+    file.write(out.data(), out.size());
+    return (bool)file.flush();
+}
+
+/**
+ * 解码pos处的一个记号，内容不完整或种类、编号无效时返回false
+ * uint32_t& end_offset - 上一个记号的结束位置，解码后更新为本记号的结束位置
+ * size_t id_num, size_t str_num - 标志符表和字符串表的表项数，用于检查编号
+ */
+static inline bool decode_token(const char*& pos, const char* end, uint32_t& end_offset, struct token& token, uint32_t& offset, uint32_t& length,
+    size_t id_num, size_t str_num)
+{
+    uint64_t kind, delta, value;
+    if (!get_varint(pos, end, kind) || !valid_kind(kind) || !get_varint(pos, end, delta) || !get_count(pos, end, UINT32_MAX, value))
+        return false;
+    int64_t begin = (int64_t)end_offset + unzigzag(delta);
+    if (begin < 0 || begin + (int64_t)value > UINT32_MAX)
+        return false;
+    offset = (uint32_t)begin;
+    length = (uint32_t)value;
+    end_offset = offset + length;
+
+    token.value.d = 0;
+    if (kind >= GREATER)
+    {
+        token.type = kind <= UNEQUAL ? RELATION_OPERATOR : ASSIGN_OPERATOR;
+        token.value.i = (int)kind;
+        return true;
+    }
+    token.type = (word_type)kind;
+    switch (token.type)
+    {
+    case KEYWORD:
+        if (!get_count(pos, end, KEYWORD_AMOUNT - 1, value))
+            return false;
+        token.value.i = (int)value;
+        break;
+    case ID:
+    case STRING:
+        if (!get_varint(pos, end, value) || value >= (token.type == ID ? id_num : str_num))
+            return false;
+        token.value.i = (int)value;
+        break;
+    case CHAR:
+        if (pos == end)
+            return false;
+        token.value.c = *pos++;
+        break;
+    case INT:
+        if (!get_varint(pos, end, value))
+            return false;
+        token.value.i = (int)unzigzag(value);
+        break;
+    case UINT:
+        if (!get_count(pos, end, UINT32_MAX, value))
+            return false;
+        token.value.ui = (unsigned int)value;
+        break;
+    case LONG:
+        if (!get_varint(pos, end, value))
+            return false;
+        token.value.l = (long)unzigzag(value);
+        break;
+    case ULONG:
+        if (!get_varint(pos, end, value))
+            return false;
+        token.value.ul = (unsigned long)value;
+        break;
+    case FLOAT:
+    {
+        if (!get_fixed(pos, end, value, 4))
+            return false;
+        uint32_t bits = (uint32_t)value;
+        memcpy(&token.value.f, &bits, sizeof(bits));
+        break;
+    }
+    case DOUBLE:
+        if (!get_fixed(pos, end, value, 8))
+            return false;
+        memcpy(&token.value.d, &value, sizeof(value));
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+bool token_file::open(const string& path)
+{
+    if (!open_source(file, path))
+        return false;
+    data = file.data;
+    size = file.size;
+    return parse();
+}
+
+bool token_file::open(const char* data, size_t size)
+{
+    close_source(file);
+    this->data = data;
+    this->size = size;
+    return parse();
+}
+
+//检查文件头和符号表，并完整解码一遍记号，保证之后的迭代不会越界
+bool token_file::parse()
+{
+    const char* pos = data;
+    const char* end = data + size;
+    uint64_t bits, amount, lines, chars, tokens_count;
+    if (size < sizeof(TOKEN_FILE_MAGIC) || memcmp(data, TOKEN_FILE_MAGIC, sizeof(TOKEN_FILE_MAGIC)) != 0)
+        return false;
+    pos += sizeof(TOKEN_FILE_MAGIC);
+    if (!get_fixed(pos, end, bits, 4) || bits != TOKEN_FILE_VERSION)
+        return false;
+    if (!get_count(pos, end, WORD_TYPE_AMOUNT, amount) || amount != WORD_TYPE_AMOUNT || !get_count(pos, end, INT32_MAX, lines)
+        || !get_count(pos, end, INT32_MAX, chars) || !get_count(pos, end, end - pos, tokens_count))
+        return false;
+    line_num = (int)lines;
+    char_num = (int)chars;
+    token_num = (size_t)tokens_count;
+    word_type_num.assign(amount, 0);
+    for (int& num : word_type_num)
+    {
+        uint64_t value;
+        if (!get_count(pos, end, INT32_MAX, value))
+            return false;
+        num = (int)value;
+    }
+    if (!get_table(pos, end, id_list) || !get_table(pos, end, str_list))
+        return false;
+    uint64_t error_num;
+    if (!get_count(pos, end, end - pos, error_num))
+        return false;
+    errors.clear();
+    errors.reserve(error_num);
+    for (uint64_t i = 0; i < error_num; i++)
+    {
+        uint64_t offset, length;
+        if (!get_count(pos, end, UINT32_MAX, offset) || !get_count(pos, end, end - pos, length))
+            return false;
+        errors.push_back({ (size_t)offset, string(pos, length) });
+        pos += length;
+    }
+
+    tokens = pos;
+    uint32_t end_offset = 0;
+    struct token token;
+    uint32_t offset, length;
+    for (size_t i = 0; i < token_num; i++)
+        if (!decode_token(pos, end, end_offset, token, offset, length, id_list.size(), str_list.size()))
+            return false;
+    return pos == end;
+}
+
+token_file::const_iterator token_file::begin() const
+{
+    const_iterator it(tokens, data + size, 0);
+    if (token_num > 0)
+        it.decode();
+    return it;
+}
+
+token_file::const_iterator token_file::end() const
+{
+    return const_iterator(data + size, data + size, 0);
+}
+
+void token_file::load(token_buffer& token_stream, symbol_table& id_list, symbol_table& str_list, int& line_num, vector<int>& word_type_num, int& char_num) const
+{
+    //符号表原本为空时，按顺序插入的编号与文件中的编号相同；否则需要重新映射
+    //文件中不保存出现次数，插入时不计数，再按记号累计
+    vector<int> id_map(this->id_list.size());
+    vector<int> str_map(this->str_list.size());
+    for (size_t i = 0; i < this->id_list.size(); i++)
+        id_map[i] = id_list.insert(this->id_list[i], 0);
+    for (size_t i = 0; i < this->str_list.size(); i++)
+        str_map[i] = str_list.insert(this->str_list[i], 0);
+
+    token_stream.reserve(token_stream.size() + token_num);
+    for (const_iterator it = begin(); it != end(); ++it)
+    {
+        struct token token = *it;
+        if (token.type == ID)
+        {
+            token.value.i = id_map[token.value.i];
+            id_list.add_count(token.value.i, 1);
+        }
+        else if (token.type == STRING)
+        {
+            token.value.i = str_map[token.value.i];
+            str_list.add_count(token.value.i, 1);
+        }
+        else if (token.type == KEYWORD)
+            id_list.add_keyword_count(token.value.i);
+        token_stream.push_back(token, it.offset(), it.length());
+    }
+    line_num += this->line_num;
+    char_num += this->char_num;
+    for (size_t i = 0; i < word_type_num.size() && i < this->word_type_num.size(); i++)
+        word_type_num[i] += this->word_type_num[i];
+}
+
+void token_file::const_iterator::decode()
+{
+    next = pos;
+    uint32_t offset = end_offset;
+    decode_token(next, limit, offset, token, token_offset, token_length, SIZE_MAX, SIZE_MAX);
+}
+
+token_file::const_iterator& token_file::const_iterator::operator++()
+{
+    end_offset = token_offset + token_length;
+    pos = next;
+    if (pos != limit)
+        decode();
+    return *this;
+}
@@ -0,0 +1,118 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "token.h"
+#include "token_buffer.h"
+#include "symbol_table.h"
+#include "source_buffer.h"
+#include "lexical_analysis.h"
+
+//二进制记号文件的魔数和版本号，格式改变时递增版本号，读取时版本号不同即视为无效
+constexpr char TOKEN_FILE_MAGIC[4] = { 'L', 'X', 'T', 'K' };
+constexpr uint32_t TOKEN_FILE_VERSION = 2;
+
+/**
+ * 把词法分析的结果编码为二进制记号文件，追加到out末尾
+ * 格式（整数除版本号外均为LEB128变长编码，有符号数先做zigzag变换）：
+ *   魔数"LXTK"、4字节小端版本号
+ *   WORD_TYPE_AMOUNT、行数、字符总数、记号数，以及每种单词类型的数量
+ *   标志符表、字符串表：表项数，每个表项为长度和内容
+ *   词法错误：错误数，每个错误为字节偏移、出错单词的长度和内容（版本2起）
+ *   记号：种类（关系运算符和赋值运算符为具体的运算符），与上一记号结束位置的偏移差，长度，
+ *         关键字、标志符和字符串的编号，整型常量的值，字符常量1字节，浮点数按小端4或8字节
+ * 参数与lexical_analysis的结果相同
+ * const std::vector<lexical_error>& errors - 分析时报告的词法错误，错误的位置只保存偏移，读回后按当时的文件名重新报告
+ */
+void encode_token_file(std::string& out, const token_buffer& token_stream, const symbol_table& id_list, const symbol_table& str_list,
+    int line_num, const std::vector<int>& word_type_num, int char_num, const std::vector<lexical_error>& errors = {});
+
+//把词法分析的结果写入二进制记号文件，成功返回true
+bool write_token_file(const std::string& path, const token_buffer& token_stream, const symbol_table& id_list, const symbol_table& str_list,
+    int line_num, const std::vector<int>& word_type_num, int char_num, const std::vector<lexical_error>& errors = {});
+
+/**
+ * 二进制记号文件的读取器
+ * 文件用mmap映射（与源程序相同），打开时检查格式并校验全部记号，之后标志符表和字符串表的表项直接指向映射的内容，
+ * 记号用迭代器在映射上逐个解码，不复制到内存；需要token_buffer和符号表时再用load还原
+ */
+class token_file
+{
+public:
+    class const_iterator;
+
+    token_file() = default;
+    token_file(const token_file&) = delete;
+    token_file& operator=(const token_file&) = delete;
+
+    //映射并检查path，文件不存在、魔数或版本号不符、内容不完整时返回false
+    bool open(const std::string& path);
+
+    //检查内存中的记号文件，data需在读取器使用期间保持有效
+    bool open(const char* data, size_t size);
+
+    int get_line_num() const { return line_num; }
+    int get_char_num() const { return char_num; }
+    const std::vector<int>& get_word_type_num() const { return word_type_num; }
+    size_t get_token_num() const { return token_num; }
+
+    //按编号取出标志符和字符串，指向文件内容
+    const std::vector<std::string_view>& get_id_list() const { return id_list; }
+    const std::vector<std::string_view>& get_str_list() const { return str_list; }
+
+    //写入时保存的词法错误
+    const std::vector<lexical_error>& get_errors() const { return errors; }
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    //还原为词法分析的结果，符号表的编号与写入时相同，各结果均追加在已有内容之后
+    void load(token_buffer& token_stream, symbol_table& id_list, symbol_table& str_list, int& line_num, std::vector<int>& word_type_num, int& char_num) const;
+
+private:
+    bool parse();
+
+    source_buffer file;
+    const char* data = nullptr;
+    size_t size = 0;
+    int line_num = 0;
+    int char_num = 0;
+    size_t token_num = 0;
+    std::vector<int> word_type_num;
+    std::vector<std::string_view> id_list;
+    std::vector<std::string_view> str_list;
+    std::vector<lexical_error> errors;
+    const char* tokens = nullptr;   //记号部分的起始位置
+};
+
+//顺序解码记号文件中的记号，打开时已校验全部记号，解码不会越界
+class token_file::const_iterator
+{
+public:
+    const_iterator(const char* pos, const char* limit, uint32_t end_offset) : pos(pos), limit(limit), end_offset(end_offset) {}
+
+    struct token operator*() const { return token; }
+    const_iterator& operator++();
+    bool operator==(const const_iterator& other) const { return pos == other.pos; }
+    bool operator!=(const const_iterator& other) const { return pos != other.pos; }
+
+    //当前记号在源程序中的字节偏移和长度
+    uint32_t offset() const { return token_offset; }
+    uint32_t length() const { return token_length; }
+
+private:
+    friend class token_file;
+
+    //解码pos处的记号，next为下一个记号的位置
+    void decode();
+
+    const char* pos;
+    const char* next = nullptr;
+    const char* limit;              //记号部分的结束位置
+    uint32_t end_offset;            //上一个记号的结束位置
+    struct token token = {};
+    uint32_t token_offset = 0;
+    uint32_t token_length = 0;
+};
@@ -0,0 +1,36 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+
+//LEB128变长整数：每字节低7位存放数值，最高位表示后面还有字节，记号文件和频率统计汇总共用
+
+inline void put_varint(std::string& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+inline bool get_varint(const char*& pos, const char* end, uint64_t& value)
+{
+    //记号的种类、偏移差和长度绝大多数只有1字节
+    if (pos != end && (unsigned char)*pos < 0x80)
+    {
+        value = (unsigned char)*pos++;
+        return true;
+    }
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (pos == end)
+            return false;
+        unsigned char byte = *pos++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (byte < 0x80)
+            return true;
+    }
+    return false;
+}